@@ -0,0 +1,194 @@
+#pragma once
+
+#ifndef __RDMALIB2_AH_CACHE_H__
+#define __RDMALIB2_AH_CACHE_H__
+
+#include "context.h"
+#include "cq.h"
+#include "qp.h"
+#include "verb.h"
+#include <cstddef>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+
+namespace rdmalib2 {
+
+//! \brief An LRU cache of address handles keyed by (GID, LID), which turns
+//! the addresses of UD peers into `rdma_ud_dest`s.
+//!
+//! Creating an address handle is a system call, so it only happens on a
+//! miss; hits are a hash lookup. Address handles are reference counted:
+//! destinations and the verbs they are set on pin theirs, so when the cache
+//! is full, evicting the least recently used one only drops the cache's
+//! reference, and the handle is destroyed once nothing refers to it. Pinned
+//! handles must be released before the context goes away.
+class rdma_ah_cache {
+public:
+    rdma_ah_cache(rdma_context const &ctx, size_t capacity = kAhCacheSize,
+                  uint8_t port = 1)
+        : ctx(ctx), capacity(capacity), port(port) {
+        RDMALIB2_ASSERT(capacity > 0);
+        index.reserve(capacity);
+    }
+
+    // Cached address handles are owned by the cache
+    rdma_ah_cache(rdma_ah_cache const &) = delete;
+    rdma_ah_cache &operator=(rdma_ah_cache const &) = delete;
+
+    rdma_ah_cache(rdma_ah_cache &&) = delete;
+    rdma_ah_cache &operator=(rdma_ah_cache &&) = delete;
+
+    ~rdma_ah_cache() = default;
+
+    size_t size() const { return lru.size(); }
+
+    //! \brief Gets the address handle of a peer, creating it on a miss.
+    std::shared_ptr<ibv_ah> get(ibv_gid const &gid, uint32_t lid) {
+        key k{gid, lid};
+        auto it = index.find(k);
+        if (likely(it != index.end())) {
+            lru.splice(lru.begin(), lru, it->second);
+            return it->second->ah;
+        }
+
+        if (lru.size() >= capacity) {
+            index.erase(lru.back().k);
+            lru.pop_back();
+        }
+
+        std::shared_ptr<ibv_ah> ah{create_ah(gid, lid), ibv_destroy_ah};
+        lru.push_front({k, ah});
+        index.emplace(k, lru.begin());
+        return ah;
+    }
+
+    //! \brief Gets the destination of a remote UD QP.
+    rdma_ud_dest get_dest(rdma_ud_qp::info const &remote,
+                          uint32_t qkey = kUdQkey) {
+        auto ah = get(remote.gid, remote.lid);
+        return {ah.get(), remote.qp_num, qkey, std::move(ah)};
+    }
+
+    //! \brief Gets the destination to reply to a UD receive completion,
+    //! given the receive buffer that starts with the GRH area.
+    //!
+    //! Without a GRH, the sender is on the local subnet and is reached by
+    //! its LID alone. On RoCEv2 over IPv4, the area holds an IPv4 header in
+    //! its last 20 bytes, whose source address maps to an IPv4-mapped GID.
+    rdma_ud_dest get_reply_dest(void const *grh, rdma_success_cqe const &cqe,
+                                uint32_t qkey = kUdQkey) {
+        ibv_gid sgid = {};
+        if (cqe.wc_flags & IBV_WC_GRH) {
+            sgid = source_gid(static_cast<uint8_t const *>(grh));
+        }
+        auto ah = get(sgid, cqe.slid);
+        return {ah.get(), cqe.src_qp, qkey, std::move(ah)};
+    }
+
+protected:
+    struct key {
+        ibv_gid gid;
+        uint32_t lid;
+
+        bool operator==(key const &other) const {
+            return lid == other.lid &&
+                   std::memcmp(gid.raw, other.gid.raw, sizeof(gid.raw)) == 0;
+        }
+    };
+
+    struct key_hash {
+        size_t operator()(key const &k) const {
+            uint64_t parts[2];
+            std::memcpy(parts, k.gid.raw, sizeof(parts));
+            return std::hash<uint64_t>{}(parts[0] ^ (parts[1] * 31) ^ k.lid);
+        }
+    };
+
+    struct entry {
+        key k;
+        std::shared_ptr<ibv_ah> ah;
+    };
+
+    //! \brief Gets the source GID of a received GRH area.
+    static ibv_gid source_gid(uint8_t const *grh) {
+        // RoCEv2 over IPv4 leaves the first 20 bytes unwritten, so they may
+        // hold a stale GRH; as in rdma-core, a valid IPv4 header in the
+        // last 20 bytes takes precedence over the IP version of the first
+        constexpr size_t ipv4_offset = sizeof(ibv_grh) - 20;
+        constexpr size_t ipv4_saddr_offset = 12;
+        ibv_gid gid = {};
+        if (is_ipv4_header(grh + ipv4_offset)) {
+            // ::ffff:a.b.c.d
+            gid.raw[10] = 0xFF;
+            gid.raw[11] = 0xFF;
+            std::memcpy(&gid.raw[12], grh + ipv4_offset + ipv4_saddr_offset,
+                        4);
+        } else {
+            RDMALIB2_ASSERT((grh[0] >> 4) == 6);
+            std::memcpy(gid.raw, grh + offsetof(ibv_grh, sgid),
+                        sizeof(gid.raw));
+        }
+        return gid;
+    }
+
+    //! \brief Checks for an option-less IPv4 header with a valid checksum.
+    static bool is_ipv4_header(uint8_t const *hdr) {
+        // Version 4, IHL of 5 words
+        if (hdr[0] != 0x45) {
+            return false;
+        }
+        // The one's complement sum over a valid header, including its
+        // checksum, is all ones
+        uint32_t sum = 0;
+        for (size_t i = 0; i < 20; i += 2) {
+            sum += static_cast<uint32_t>(hdr[i]) << 8 | hdr[i + 1];
+        }
+        while (sum >> 16) {
+            sum = (sum & 0xFFFF) + (sum >> 16);
+        }
+        return sum == 0xFFFF;
+    }
+
+    ibv_ah *create_ah(ibv_gid const &gid, uint32_t lid) {
+        ibv_ah_attr attr = {};
+        attr.dlid = lid;
+        attr.sl = 0;
+        attr.src_path_bits = 0;
+        attr.port_num = port;
+
+        // RoCE always routes by GID, InfiniBand only when one is given
+        ibv_gid zero = {};
+        if (std::memcmp(gid.raw, zero.raw, sizeof(gid.raw)) != 0) {
+            attr.is_global = 1;
+            attr.grh.dgid = gid;
+            attr.grh.hop_limit = 0xFF;
+            attr.grh.sgid_index = rdma_context::universal_gid_index;
+            attr.grh.traffic_class = 0;
+        }
+
+        ibv_ah *ah = ibv_create_ah(ctx.get_pd(), &attr);
+        if (!ah) {
+            spdlog::error("failed to create address handle for <gid {:x}-{:x}, "
+                          "lid {}>",
+                          gid.global.subnet_prefix, gid.global.interface_id,
+                          lid);
+            panic_with_errno();
+        }
+        return ah;
+    }
+
+    rdma_context const &ctx;
+    size_t capacity;
+    uint8_t port;
+
+    // Most recently used first
+    std::list<entry> lru;
+    std::unordered_map<key, std::list<entry>::iterator, key_hash> index;
+};
+
+} // namespace rdmalib2
+
+#endif // __RDMALIB2_AH_CACHE_H__
@@ -0,0 +1,229 @@
+#pragma once
+
+#ifndef __RDMALIB2_BATCH_H__
+#define __RDMALIB2_BATCH_H__
+
+#include "mem.h"
+#include "qp.h"
+#include "verb.h"
+#include <cstddef>
+#include <memory>
+
+namespace rdmalib2 {
+
+//! \brief A fixed-capacity batch of up to `N` send verbs posted with a single
+//! doorbell.
+//!
+//! The work requests and their scatter-gather lists live in contiguous arrays
+//! and are linked once at construction, so posting the batch hands the first
+//! work request straight to the provider. Each slot is refilled in place by
+//! writing the work request fields directly; there is no cached copy to
+//! rebuild. Slots have at most `MaxSge` scatter-gather entries each.
+//!
+//! Unlike `rdma_verb`, slots are not validated against their opcode, and the
+//! QP's inline policy does not apply: use `set_inline()` per slot instead.
+template <size_t N, uint32_t MaxSge = 1> class rdma_verb_batch {
+    static_assert(N > 0, "batch capacity must be positive");
+    static_assert(MaxSge > 0 && MaxSge <= kMaxSge,
+                  "scatter-gather list capacity exceeds QP limit kMaxSge");
+
+    template <ibv_qp_type Type> friend class rdma_qp;
+
+public:
+    rdma_verb_batch() {
+        for (size_t i = 0; i < N; ++i) {
+            wrs[i] = {};
+            wrs[i].sg_list = &sges[i * MaxSge];
+            wrs[i].next = i + 1 < N ? &wrs[i + 1] : nullptr;
+        }
+    }
+
+    // Work requests point into the batch itself
+    rdma_verb_batch(rdma_verb_batch const &) = delete;
+    rdma_verb_batch &operator=(rdma_verb_batch const &) = delete;
+
+    rdma_verb_batch(rdma_verb_batch &&) = delete;
+    rdma_verb_batch &operator=(rdma_verb_batch &&) = delete;
+
+    ~rdma_verb_batch() = default;
+
+    static constexpr size_t capacity() { return N; }
+
+    //! \brief Gets the number of slots that will be posted.
+    size_t size() const { return count; }
+
+    //! \brief Sets the number of slots that will be posted, i.e., the first
+    //! `size` slots.
+    rdma_verb_batch &set_size(size_t size) {
+        RDMALIB2_ASSERT(size <= N);
+        if (size != count) {
+            if (count > 0 && count < N) {
+                wrs[count - 1].next = &wrs[count];
+            }
+            if (size > 0) {
+                wrs[size - 1].next = nullptr;
+            }
+            count = size;
+        }
+        return *this;
+    }
+
+    //! \brief Sets the work request ID of a slot.
+    rdma_verb_batch &set_id(size_t i, uint64_t id) {
+        RDMALIB2_ASSERT(!(id & rdma_sq_tracker::wr_id_tag));
+        wr_ids[i] = id;
+        wrs[i].wr_id = id;
+        return *this;
+    }
+
+    uint64_t get_id(size_t i) const { return wr_ids[i]; }
+
+    //! \brief Sets the opcode of a slot.
+    //!
+    //! The opcode decides where `set_remote_memory()` stores the remote
+    //! address, so set it first.
+    template <ibv_exp_wr_opcode Opcode>
+    rdma_verb_batch &set_op(size_t i, wr_type_base<Opcode> const &) {
+        wrs[i].exp_opcode = Opcode;
+        return *this;
+    }
+
+    //! \brief Sets the scatter-gather list of a slot.
+    template <typename... MemSlice>
+    rdma_verb_batch &set_sgl_entry(size_t i, rdma_memory_slice const &head,
+                                   MemSlice const &...tail) {
+        static_assert(1 + sizeof...(tail) <= MaxSge,
+                      "too many scatter-gather list entries");
+        ibv_sge *sge = wrs[i].sg_list;
+        sge[0] = head.to_sge();
+        int n = 1;
+        ((sge[n++] = tail.to_sge()), ...);
+        wrs[i].num_sge = n;
+        return *this;
+    }
+
+    //! \brief Sets the remote memory of a read, write or atomic slot.
+    rdma_verb_batch &set_remote_memory(size_t i,
+                                       rdma_remote_memory_slice const &remote) {
+        ibv_exp_send_wr &wr = wrs[i];
+        if (wr.exp_opcode == IBV_EXP_WR_ATOMIC_CMP_AND_SWP ||
+            wr.exp_opcode == IBV_EXP_WR_ATOMIC_FETCH_AND_ADD) {
+            wr.wr.atomic.remote_addr = remote.get_addr();
+            wr.wr.atomic.rkey = remote.get_rkey();
+        } else {
+            wr.wr.rdma.remote_addr = remote.get_addr();
+            wr.wr.rdma.rkey = remote.get_rkey();
+        }
+        return *this;
+    }
+
+    //! \brief Sets the destination of a send slot posted to a UD QP.
+    rdma_verb_batch &set_ud_dest(size_t i, rdma_ud_dest const &dest) {
+        wrs[i].wr.ud.ah = dest.ah;
+        wrs[i].wr.ud.remote_qpn = dest.remote_qpn;
+        wrs[i].wr.ud.remote_qkey = dest.remote_qkey;
+        ah_pins[i] = dest.pin;
+        return *this;
+    }
+
+    //! \brief Sets the destination of a slot posted to a DC initiator.
+    rdma_verb_batch &set_dc_dest(size_t i, rdma_dc_dest const &dest) {
+        wrs[i].dc.ah = dest.ah;
+        wrs[i].dc.dct_access_key = dest.dc_key;
+        wrs[i].dc.dct_number = dest.dct_number;
+        ah_pins[i] = dest.pin;
+        return *this;
+    }
+
+    //! \brief Sets the remote XRC SRQ of a slot posted to an XRC send QP.
+    rdma_verb_batch &set_remote_srq(size_t i, uint32_t srq_num) {
+        wrs[i].qp_type.xrc.remote_srqn = srq_num;
+        return *this;
+    }
+
+    rdma_verb_batch &set_notify(size_t i, bool notify) {
+        notified[i] = notify;
+        if (notify) {
+            wrs[i].exp_send_flags |= IBV_EXP_SEND_SIGNALED;
+        } else {
+            wrs[i].exp_send_flags &= ~IBV_EXP_SEND_SIGNALED;
+        }
+        return *this;
+    }
+
+    bool is_notified(size_t i) const { return notified[i]; }
+
+    rdma_verb_batch &set_inline(size_t i, bool inline_data) {
+        if (inline_data) {
+            wrs[i].exp_send_flags |= IBV_EXP_SEND_INLINE;
+        } else {
+            wrs[i].exp_send_flags &= ~IBV_EXP_SEND_INLINE;
+        }
+        return *this;
+    }
+
+    rdma_verb_batch &set_imm(size_t i, uint32_t imm_data) {
+        wrs[i].ex.imm_data = imm_data;
+        return *this;
+    }
+
+    rdma_verb_batch &set_cas(size_t i, uint64_t compare, uint64_t swap) {
+        wrs[i].exp_opcode = IBV_EXP_WR_ATOMIC_CMP_AND_SWP;
+        wrs[i].wr.atomic.compare_add = compare;
+        wrs[i].wr.atomic.swap = swap;
+        return *this;
+    }
+
+    rdma_verb_batch &set_faa(size_t i, uint64_t add) {
+        wrs[i].exp_opcode = IBV_EXP_WR_ATOMIC_FETCH_AND_ADD;
+        wrs[i].wr.atomic.compare_add = add;
+        return *this;
+    }
+
+    //! \brief Fills a slot with a one-sided RDMA read in one call.
+    rdma_verb_batch &set_read(size_t i, rdma_memory_slice const &local,
+                              rdma_remote_memory_slice const &remote,
+                              uint64_t id) {
+        set_op(i, op_read);
+        set_sgl_entry(i, local);
+        set_remote_memory(i, remote);
+        return set_id(i, id);
+    }
+
+    //! \brief Fills a slot with a one-sided RDMA write in one call.
+    rdma_verb_batch &set_write(size_t i, rdma_memory_slice const &local,
+                               rdma_remote_memory_slice const &remote,
+                               uint64_t id) {
+        set_op(i, op_write);
+        set_sgl_entry(i, local);
+        set_remote_memory(i, remote);
+        return set_id(i, id);
+    }
+
+    //! \brief Gets the raw work request of a slot.
+    ibv_exp_send_wr &get_wr(size_t i) { return wrs[i]; }
+    ibv_exp_send_wr const &get_wr(size_t i) const { return wrs[i]; }
+
+    template <ibv_qp_type Type> void execute(rdma_qp<Type> const &qp) {
+        qp.post_verb(*this);
+    }
+
+protected:
+    ibv_exp_send_wr wrs[N];
+    ibv_sge sges[N * MaxSge];
+
+    // Original wr_ids and signaling, as the send queue tracker may overwrite
+    // the ones in the work requests
+    uint64_t wr_ids[N] = {};
+    bool notified[N] = {};
+    bool signaling_patched = false;
+
+    // Address handles of the destinations that came from a cache
+    std::shared_ptr<ibv_ah> ah_pins[N];
+
+    size_t count = N;
+};
+
+} // namespace rdmalib2
+
+#endif // __RDMALIB2_BATCH_H__
@@ -4,22 +4,30 @@
 #define __RDMALIB2_CM_H__
 
 #include <functional>
+#include <memory>
 #include <hrpc/client.h>
 #include <hrpc/server.h>
 
 #include "context.h"
 #include "cq.h"
 #include "mem.h"
+#include "pool.h"
 #include "qp.h"
 
 namespace rdmalib2 {
 
 class cm {
 public:
+    // The QP refers to its CQs, so they are handed over on the heap to keep
+    // their addresses
     using qp_callback_t =
-        std::function<void(rdma_rc_qp qp, rdma_cq send_cq, rdma_cq recv_cq)>;
+        std::function<void(rdma_rc_qp qp, std::unique_ptr<rdma_cq> send_cq,
+                           std::unique_ptr<rdma_cq> recv_cq)>;
     using qp_callback_with_stop_t =
-        std::function<bool(rdma_rc_qp qp, rdma_cq send_cq, rdma_cq recv_cq)>;
+        std::function<bool(rdma_rc_qp qp, std::unique_ptr<rdma_cq> send_cq,
+                           std::unique_ptr<rdma_cq> recv_cq)>;
+    using shared_qp_callback_t = std::function<void(rdma_rc_qp qp)>;
+    using shared_qp_callback_with_stop_t = std::function<bool(rdma_rc_qp qp)>;
 
 public:
     cm(rdma_context const &ctx) : ctx(ctx) {}
@@ -49,45 +57,58 @@ public:
     void run_server(qp_callback_t qp_callback, uint16_t port = kRpcPort) {
         hrpc::server svr{port};
         svr.bind(RPC_ESTABLISH, [this, qp_callback](rdma_rc_qp::info info) {
-            rdma_cq send_cq{ctx}, recv_cq{ctx};
-            rdma_rc_qp qp{ctx, send_cq, recv_cq, kQpDepth,
-                          rdma_rc_qp::extended_atomics};
-            qp.connect(info);
-
+            auto send_cq = std::make_unique<rdma_cq>(ctx);
+            auto recv_cq = std::make_unique<rdma_cq>(ctx);
+            rdma_rc_qp qp = accept(info, *send_cq, *recv_cq);
             auto self_info = qp.get_info();
-            spdlog::trace(
-                "connected local qp <gid {:x}-{:x}, lid {}, qpn {}, psn {}> to "
-                "remote qp <gid {:x}-{:x}, lid {}, qpn {}, psn {}>",
-                self_info.gid.global.subnet_prefix,
-                self_info.gid.global.interface_id, self_info.lid,
-                self_info.qp_num, self_info.psn, info.gid.global.subnet_prefix,
-                info.gid.global.interface_id, info.lid, info.qp_num, info.psn);
-
             qp_callback(std::move(qp), std::move(send_cq), std::move(recv_cq));
             return self_info;
         });
         svr.run();
     }
 
+    //! \brief Runs the server with every accepted QP completing into the
+    //! given CQs, which the caller polls, e.g., through an `rdma_cq_demux`.
+    //! The CQs must be deep enough for all connections.
+    void run_server(shared_qp_callback_t qp_callback, rdma_cq const &send_cq,
+                    rdma_cq const &recv_cq, uint16_t port = kRpcPort) {
+        hrpc::server svr{port};
+        svr.bind(RPC_ESTABLISH, [this, qp_callback, &send_cq,
+                                 &recv_cq](rdma_rc_qp::info info) {
+            rdma_rc_qp qp = accept(info, send_cq, recv_cq);
+            auto self_info = qp.get_info();
+            qp_callback(std::move(qp));
+            return self_info;
+        });
+        svr.run();
+    }
+
+    //! \brief Runs the server with every accepted QP taken from a warm pool,
+    //! so that accepting a connection only costs the state transitions.
+    void run_server(shared_qp_callback_t qp_callback,
+                    rdma_warm_qp_pool<IBV_QPT_RC> &pool,
+                    uint16_t port = kRpcPort) {
+        hrpc::server svr{port};
+        svr.bind(RPC_ESTABLISH,
+                 [this, qp_callback, &pool](rdma_rc_qp::info info) {
+                     rdma_rc_qp qp = pool.acquire();
+                     establish(qp, info);
+                     auto self_info = qp.get_info();
+                     qp_callback(std::move(qp));
+                     return self_info;
+                 });
+        svr.run();
+    }
+
     void run_server_with_stop(qp_callback_with_stop_t qp_callback,
                               uint16_t port = kRpcPort) {
         hrpc::server svr{port};
         svr.bind(RPC_ESTABLISH, [this, qp_callback](hrpc::server *self,
                                                     rdma_rc_qp::info info) {
-            rdma_cq send_cq{ctx}, recv_cq{ctx};
-            rdma_rc_qp qp{ctx, send_cq, recv_cq, kQpDepth,
-                          rdma_rc_qp::extended_atomics};
-            qp.connect(info);
-
+            auto send_cq = std::make_unique<rdma_cq>(ctx);
+            auto recv_cq = std::make_unique<rdma_cq>(ctx);
+            rdma_rc_qp qp = accept(info, *send_cq, *recv_cq);
             auto self_info = qp.get_info();
-            spdlog::trace(
-                "connected local qp <gid {:x}-{:x}, lid {}, qpn {}, psn {}> to "
-                "remote qp <gid {:x}-{:x}, lid {}, qpn {}, psn {}>",
-                self_info.gid.global.subnet_prefix,
-                self_info.gid.global.interface_id, self_info.lid,
-                self_info.qp_num, self_info.psn, info.gid.global.subnet_prefix,
-                info.gid.global.interface_id, info.lid, info.qp_num, info.psn);
-
             bool should_stop = qp_callback(std::move(qp), std::move(send_cq),
                                            std::move(recv_cq));
             if (should_stop) {
@@ -98,9 +119,49 @@ public:
         svr.run();
     }
 
+    void run_server_with_stop(shared_qp_callback_with_stop_t qp_callback,
+                              rdma_cq const &send_cq, rdma_cq const &recv_cq,
+                              uint16_t port = kRpcPort) {
+        hrpc::server svr{port};
+        svr.bind(RPC_ESTABLISH,
+                 [this, qp_callback, &send_cq, &recv_cq](
+                     hrpc::server *self, rdma_rc_qp::info info) {
+                     rdma_rc_qp qp = accept(info, send_cq, recv_cq);
+                     auto self_info = qp.get_info();
+                     if (qp_callback(std::move(qp))) {
+                         self->stop();
+                     }
+                     return self_info;
+                 });
+        svr.run();
+    }
+
 protected:
     static constexpr hrpc::hrpc_id_t RPC_ESTABLISH = 1;
 
+    //! \brief Creates a QP on the given CQs and connects it to a remote QP.
+    rdma_rc_qp accept(rdma_rc_qp::info const &info, rdma_cq const &send_cq,
+                      rdma_cq const &recv_cq) {
+        rdma_rc_qp qp{ctx, send_cq, recv_cq, kQpDepth,
+                      rdma_rc_qp::extended_atomics};
+        establish(qp, info);
+        return qp;
+    }
+
+    //! \brief Connects a QP in RESET state to a remote QP.
+    void establish(rdma_rc_qp &qp, rdma_rc_qp::info const &info) {
+        qp.connect(info);
+
+        auto self_info = qp.get_info();
+        spdlog::trace(
+            "connected local qp <gid {:x}-{:x}, lid {}, qpn {}, psn {}> to "
+            "remote qp <gid {:x}-{:x}, lid {}, qpn {}, psn {}>",
+            self_info.gid.global.subnet_prefix,
+            self_info.gid.global.interface_id, self_info.lid, self_info.qp_num,
+            self_info.psn, info.gid.global.subnet_prefix,
+            info.gid.global.interface_id, info.lid, info.qp_num, info.psn);
+    }
+
     rdma_context const &ctx;
 };
 
@@ -5,6 +5,7 @@
 
 #include <infiniband/verbs.h>
 #include <new>
+#include <poll.h>
 #include <optional>
 #include <stdexcept>
 #include <string_view>
@@ -152,6 +153,34 @@ public:
         return std::get<0>(port_attrs[port - 1]);
     }
 
+    //! \brief Fetches and acknowledges the next asynchronous event of the
+    //! device, waiting for at most `timeout_ms` milliseconds (-1 for
+    //! indefinitely).
+    std::optional<ibv_async_event> get_async_event(int timeout_ms = 0) const {
+        pollfd pfd = {.fd = ctx->async_fd, .events = POLLIN, .revents = 0};
+        if (poll(&pfd, 1, timeout_ms) <= 0) {
+            return std::nullopt;
+        }
+
+        ibv_async_event event = {};
+        if (ibv_get_async_event(ctx, &event)) {
+            return std::nullopt;
+        }
+        ibv_ack_async_event(&event);
+        return std::make_optional(event);
+    }
+
+    ibv_exp_device_attr const &get_device_attr() const { return dev_attr; }
+
+    ibv_exp_port_attr const &get_port_attr(uint8_t port = 1) const {
+        if (port > port_attrs.size()) {
+            spdlog::error("port {} is out of port count bound {}", port,
+                          dev_attr.phys_port_cnt);
+            panic();
+        }
+        return std::get<1>(port_attrs[port - 1]);
+    }
+
     uint32_t get_port_lid(uint8_t port = 1) const {
         if (port > port_attrs.size()) {
             spdlog::error("port {} is out of port count bound {}", port,
@@ -0,0 +1,207 @@
+#pragma once
+
+#ifndef __RDMALIB2_CORO_H__
+#define __RDMALIB2_CORO_H__
+
+#include "cq.h"
+#include "mem.h"
+#include "qp.h"
+#include "router.h"
+#include "verb.h"
+#include <coroutine>
+#include <exception>
+#include <vector>
+
+namespace rdmalib2 {
+
+class rdma_scheduler;
+
+namespace detail {
+inline thread_local rdma_scheduler *current_scheduler = nullptr;
+} // namespace detail
+
+//! \brief Drives coroutines that await RDMA verbs on the current thread.
+//!
+//! Each thread owns at most one scheduler, which becomes the target of every
+//! awaitable verb created on that thread. Awaiting a verb posts it signaled,
+//! with a completion router slot that resumes the awaiting coroutine, and
+//! suspends; `poll()` and `run()` poll the registered CQs and resume
+//! coroutines as their verbs complete. Every CQ registered here must only
+//! carry completions of awaited verbs.
+class rdma_scheduler {
+public:
+    explicit rdma_scheduler(uint32_t max_inflight = kQpDepth)
+        : router(max_inflight) {
+        RDMALIB2_ASSERT(!detail::current_scheduler);
+        detail::current_scheduler = this;
+    }
+
+    // Suspended coroutines refer to the scheduler
+    rdma_scheduler(rdma_scheduler const &) = delete;
+    rdma_scheduler &operator=(rdma_scheduler const &) = delete;
+
+    rdma_scheduler(rdma_scheduler &&) = delete;
+    rdma_scheduler &operator=(rdma_scheduler &&) = delete;
+
+    ~rdma_scheduler() {
+        RDMALIB2_ASSERT(detail::current_scheduler == this);
+        detail::current_scheduler = nullptr;
+    }
+
+    //! \brief Gets the scheduler of the current thread.
+    static rdma_scheduler &current() {
+        RDMALIB2_ASSERT(detail::current_scheduler);
+        return *detail::current_scheduler;
+    }
+
+    //! \brief Registers a CQ that awaited verbs complete into.
+    rdma_scheduler &add_cq(rdma_cq const &cq) {
+        cqs.push_back(&cq);
+        return *this;
+    }
+
+    rdma_completion_router &get_router() { return router; }
+
+    //! \brief Gets the number of coroutines that have not finished yet.
+    size_t get_num_tasks() const { return num_tasks; }
+
+    //! \brief Polls every registered CQ once, resuming the coroutines whose
+    //! verbs completed.
+    //!
+    //! \return The number of coroutines resumed.
+    int poll() {
+        int ret = 0;
+        for (rdma_cq const *cq : cqs) {
+            ret += router.poll(*cq);
+        }
+        return ret;
+    }
+
+    //! \brief Polls until every coroutine has finished.
+    void run() {
+        while (num_tasks > 0) {
+            poll();
+        }
+    }
+
+protected:
+    friend class rdma_task;
+
+    rdma_completion_router router;
+    std::vector<rdma_cq const *> cqs;
+    size_t num_tasks = 0;
+};
+
+//! \brief A fire-and-forget coroutine driven by the current thread's
+//! `rdma_scheduler`.
+//!
+//! The coroutine starts running as soon as it is called and frees itself
+//! when it finishes.
+class rdma_task {
+public:
+    struct promise_type {
+        promise_type() { ++rdma_scheduler::current().num_tasks; }
+
+        rdma_task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept {
+            --rdma_scheduler::current().num_tasks;
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+//! \brief Awaitable that posts a verb and resumes with its completion.
+template <typename Verb, ibv_qp_type Type> class rdma_verb_awaiter {
+public:
+    rdma_verb_awaiter(rdma_qp<Type> const &qp, Verb const &verb)
+        : qp(qp), verb(verb) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        this->handle = handle;
+        rdma_scheduler::current().get_router().post(
+            qp, verb, [this](rdma_success_cqe const &cqe) {
+                this->cqe = cqe;
+                this->handle.resume();
+            });
+    }
+
+    rdma_success_cqe await_resume() const noexcept { return cqe; }
+
+protected:
+    rdma_qp<Type> const &qp;
+    Verb verb;
+    std::coroutine_handle<> handle;
+    rdma_success_cqe cqe = {};
+};
+
+//! \brief Awaitable atomic verb that resumes with the original remote value.
+template <typename Verb, ibv_qp_type Type>
+class rdma_atomic_awaiter : public rdma_verb_awaiter<Verb, Type> {
+public:
+    rdma_atomic_awaiter(rdma_qp<Type> const &qp, Verb const &verb,
+                        rdma_memory_slice const &local)
+        : rdma_verb_awaiter<Verb, Type>(qp, verb), local(local) {}
+
+    uint64_t await_resume() const noexcept {
+        return *static_cast<uint64_t const *>(local.get_ptr());
+    }
+
+protected:
+    rdma_memory_slice local;
+};
+
+template <ibv_qp_type Type>
+rdma_verb_awaiter<rdma_read, Type>
+async_read(rdma_qp<Type> const &qp, rdma_memory_slice const &local,
+           rdma_remote_memory_slice const &remote) {
+    rdma_read verb{local};
+    verb.set_remote_memory(remote);
+    return {qp, verb};
+}
+
+template <ibv_qp_type Type>
+rdma_verb_awaiter<rdma_write, Type>
+async_write(rdma_qp<Type> const &qp, rdma_memory_slice const &local,
+            rdma_remote_memory_slice const &remote) {
+    rdma_write verb{local};
+    verb.set_remote_memory(remote);
+    return {qp, verb};
+}
+
+template <ibv_qp_type Type>
+rdma_verb_awaiter<rdma_send, Type> async_send(rdma_qp<Type> const &qp,
+                                              rdma_memory_slice const &local) {
+    return {qp, rdma_send{local}};
+}
+
+//! \brief Compare-and-swaps 8 bytes of remote memory, fetching the original
+//! value into `local`.
+template <ibv_qp_type Type>
+rdma_atomic_awaiter<rdma_cas, Type>
+async_cas(rdma_qp<Type> const &qp, rdma_memory_slice const &local,
+          rdma_remote_memory_slice const &remote, uint64_t compare,
+          uint64_t swap) {
+    rdma_cas verb{local};
+    verb.set_remote_memory(remote).set_cas(compare, swap);
+    return {qp, verb, local};
+}
+
+//! \brief Fetches and adds to 8 bytes of remote memory, fetching the original
+//! value into `local`.
+template <ibv_qp_type Type>
+rdma_atomic_awaiter<rdma_faa, Type>
+async_faa(rdma_qp<Type> const &qp, rdma_memory_slice const &local,
+          rdma_remote_memory_slice const &remote, uint64_t add) {
+    rdma_faa verb{local};
+    verb.set_remote_memory(remote).set_faa(add);
+    return {qp, verb, local};
+}
+
+} // namespace rdmalib2
+
+#endif // __RDMALIB2_CORO_H__
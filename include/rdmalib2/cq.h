@@ -4,8 +4,15 @@
 #define __RDMALIB2_CQ_H__
 
 #include "context.h"
+#include <algorithm>
+#include <cerrno>
+#include <concepts>
+#include <fcntl.h>
+#include <functional>
 #include <new>
 #include <optional>
+#include <span>
+#include <utility>
 #include <vector>
 
 namespace rdmalib2 {
@@ -28,17 +35,177 @@ struct rdma_success_cqe {
     uint64_t wr_id;
     uint32_t length;
     uint32_t imm_data;
+    uint32_t qp_num = 0;
+    //! Source QP number and LID of a UD receive completion
+    uint32_t src_qp = 0;
+    uint16_t slid = 0;
+    //! `ibv_wc_flags` of the completion, e.g., whether a GRH is present
+    uint32_t wc_flags = 0;
 
     static constexpr op_type to_op_type(ibv_wc_opcode op) {
         return static_cast<op_type>(op);
     }
+
+    static constexpr rdma_success_cqe from_wc(ibv_wc const &wc) {
+        return {to_op_type(wc.opcode),
+                wc.wr_id,
+                wc.byte_len,
+                wc.imm_data,
+                wc.qp_num,
+                wc.src_qp,
+                static_cast<uint16_t>(wc.slid),
+                static_cast<uint32_t>(wc.wc_flags)};
+    }
+};
+
+//! \brief A completion with an error status, e.g., a work request that hit a
+//! transport error or was flushed after one.
+struct rdma_error_cqe {
+    //! Empty if the work request was unsignaled on a tracked QP
+    std::optional<uint64_t> wr_id;
+    ibv_wc_status status;
+    uint32_t qp_num;
+    uint32_t vendor_err;
+};
+
+//! \brief Send queue occupancy tracker for automatic selective signaling.
+//!
+//! Every work request posted on a tracked QP occupies a send queue slot until a
+//! signaled work request posted after it completes. The tracker signals at
+//! least every `interval`-th work request, and posts every signaled work
+//! request with a tagged wr_id pointing back to itself, so that `rdma_cq` can
+//! retire the slots while polling. Completions the caller asked for are
+//! delivered with their original wr_id; the others are swallowed.
+//!
+//! Send wr_ids with the top bit set are reserved on every QP, tracked or
+//! not: CQs tell tracked completions apart by that bit alone, and any CQ may
+//! be shared with a tracked QP. Posting asserts that the bit is clear.
+class rdma_sq_tracker {
+public:
+    static constexpr uint64_t wr_id_tag = 1ull << 63;
+
+    rdma_sq_tracker(uint32_t depth, uint32_t interval)
+        : depth(depth), interval(interval), entries(depth) {
+        RDMALIB2_ASSERT(interval > 0 && interval <= depth);
+    }
+
+    rdma_sq_tracker(rdma_sq_tracker const &) = delete;
+    rdma_sq_tracker &operator=(rdma_sq_tracker const &) = delete;
+
+    uint32_t get_depth() const { return depth; }
+    uint32_t get_interval() const { return interval; }
+    uint32_t get_outstanding() const { return outstanding; }
+    uint32_t get_available() const { return depth - outstanding; }
+
+    //! \brief Gets the most work requests that can wait for free slots at
+    //! once. Up to `interval - 1` trailing unsignaled work requests keep
+    //! their slots until a later signaled one completes, so larger posts
+    //! must be split.
+    uint32_t get_max_post() const { return depth - interval + 1; }
+
+    //! \brief Forgets every in-flight work request, e.g., once the QP has
+    //! been reset and its send queue discarded.
+    void clear() {
+        outstanding = 0;
+        unsignaled = 0;
+        head = 0;
+        tail = 0;
+    }
+
+    //! \brief Accounts for one posted work request.
+    //!
+    //! Returns the wr_id to post it with if it must be signaled, or
+    //! `std::nullopt` if it can go unsignaled.
+    std::optional<uint64_t> track(uint64_t wr_id, bool notified) {
+        ++outstanding;
+        ++unsignaled;
+        if (!notified && unsignaled < interval) {
+            return std::nullopt;
+        }
+
+        entries[tail] = {wr_id, unsignaled, notified};
+        tail = (tail + 1) % depth;
+        unsignaled = 0;
+        return wr_id_tag | reinterpret_cast<uint64_t>(this);
+    }
+
+    //! \brief Retires the oldest in-flight signaled work request together
+    //! with the unsignaled ones posted before it.
+    //!
+    //! Returns its original wr_id if the caller asked for the completion.
+    std::optional<uint64_t> retire() {
+        auto const &entry = entries[head];
+        head = (head + 1) % depth;
+        outstanding -= entry.slots;
+        return entry.notified ? std::make_optional(entry.wr_id) : std::nullopt;
+    }
+
+    static bool is_tagged(ibv_wc const &wc) {
+        return wc.opcode < IBV_WC_RECV && (wc.wr_id & wr_id_tag);
+    }
+
+    static rdma_sq_tracker *from_wr_id(uint64_t wr_id) {
+        return reinterpret_cast<rdma_sq_tracker *>(wr_id & ~wr_id_tag);
+    }
+
+protected:
+    struct entry {
+        uint64_t wr_id;
+        uint32_t slots;
+        bool notified;
+    };
+
+    uint32_t depth;
+    uint32_t interval;
+    uint32_t outstanding = 0;
+    uint32_t unsignaled = 0;
+
+    // In-flight signaled work requests, in posting order
+    std::vector<entry> entries;
+    uint32_t head = 0;
+    uint32_t tail = 0;
 };
 
 class rdma_cq {
 public:
-    rdma_cq(rdma_context const &ctx, int cq_depth = kCqDepth,
-            void *cq_context = nullptr) {
-        auto cq = create_rdma_cq(ctx, cq_depth, cq_context);
+    //! Returns whether the error was handled; unhandled errors panic.
+    using error_handler_t = std::function<bool(rdma_error_cqe const &)>;
+
+protected:
+    enum : uint32_t {
+        feature_channel = 1 << 0,
+        feature_compressed_cqe = 1 << 1,
+    };
+
+    template <uint32_t Features> struct cq_feature_base {
+        static constexpr uint32_t features = Features;
+
+        template <uint32_t Features2>
+        constexpr cq_feature_base<Features | Features2>
+        operator+(cq_feature_base<Features2>) const {
+            return {};
+        }
+    };
+
+public:
+    static constexpr cq_feature_base<0> no_features = {};
+    static constexpr cq_feature_base<feature_channel> event_channel = {};
+
+    //! Lets the device compress runs of similar CQEs to save PCIe bandwidth
+    //! at high message rates. The provider decompresses them transparently
+    //! while polling.
+    static constexpr cq_feature_base<feature_compressed_cqe> compressed_cqe =
+        {};
+
+    template <uint32_t F>
+    rdma_cq(rdma_context const &ctx, int cq_depth,
+            cq_feature_base<F> const &features, void *cq_context = nullptr)
+        : deferred(cq_depth) {
+        if constexpr (F & feature_channel) {
+            channel = create_comp_channel(ctx);
+        }
+
+        auto cq = create_rdma_cq(ctx, cq_depth, cq_context, channel, features);
         if (cq.has_value()) {
             this->cq = cq.value();
             spdlog::trace(
@@ -54,10 +221,28 @@ public:
         }
     }
 
+    rdma_cq(rdma_context const &ctx, int cq_depth = kCqDepth,
+            void *cq_context = nullptr)
+        : rdma_cq(ctx, cq_depth, no_features, cq_context) {}
+
     rdma_cq(rdma_cq const &) = delete;
     rdma_cq &operator=(rdma_cq const &) = delete;
 
-    rdma_cq(rdma_cq &&other) noexcept : cq(other.cq) { other.cq = nullptr; }
+    rdma_cq(rdma_cq &&other) noexcept
+        : cq(other.cq),
+          deferred(std::move(other.deferred)),
+          deferred_head(other.deferred_head),
+          deferred_tail(other.deferred_tail),
+          burst(other.burst),
+          tracked(other.tracked),
+          error_handler(std::move(other.error_handler)),
+          channel(other.channel),
+          spin_budget(other.spin_budget),
+          armed(other.armed) {
+        other.cq = nullptr;
+        other.burst = nullptr;
+        other.channel = nullptr;
+    }
 
     rdma_cq &operator=(rdma_cq &&other) & noexcept {
         if (this != &other) {
@@ -68,51 +253,236 @@ public:
     }
 
     ~rdma_cq() {
+        if (burst) {
+            ibv_exp_release_intf_params params = {};
+            ibv_exp_release_intf(cq->context, burst, &params);
+            burst = nullptr;
+        }
         if (cq) {
             spdlog::trace("destroying completion queue {:p}",
                           reinterpret_cast<void *>(cq));
             ibv_destroy_cq(cq);
             cq = nullptr;
         }
+        if (channel) {
+            ibv_destroy_comp_channel(channel);
+            channel = nullptr;
+        }
     }
 
     ibv_cq *get_cq() const { return cq; }
 
+    //! \brief Gets the non-blocking file descriptor of the completion
+    //! channel, for integration with epoll, or -1 without a channel.
+    //!
+    //! When it turns readable, call `consume_events()`, drain the CQ and then
+    //! `arm()` it again before going back to sleep.
+    int get_event_fd() const { return channel ? channel->fd : -1; }
+
+    //! \brief Sets how many consecutive empty polls the blocking polls spin
+    //! before they sleep on the completion channel.
+    rdma_cq &set_spin_budget(uint32_t budget) {
+        spin_budget = budget;
+        return *this;
+    }
+
+    uint32_t get_spin_budget() const { return spin_budget; }
+
+    //! \brief Sets CQ moderation, which delays the completion event until
+    //! `cq_count` completions have accumulated or `cq_period` microseconds
+    //! have passed, cutting the interrupt rate in event mode.
+    rdma_cq &set_moderation(uint16_t cq_count, uint16_t cq_period) {
+        ibv_exp_cq_attr attr = {};
+        attr.comp_mask = IBV_EXP_CQ_ATTR_MODERATION;
+        attr.moderation.cq_count = cq_count;
+        attr.moderation.cq_period = cq_period;
+        if (ibv_exp_modify_cq(cq, &attr, IBV_EXP_CQ_MODERATION)) {
+            spdlog::error("failed to set moderation <count {}, period {}> on "
+                          "completion queue {:p}",
+                          cq_count, cq_period, reinterpret_cast<void *>(cq));
+            panic_with_errno();
+        }
+        return *this;
+    }
+
+    //! \brief Requests a completion event for the next completion.
+    void arm() const {
+        RDMALIB2_ASSERT(channel);
+        if (ibv_req_notify_cq(cq, 0)) {
+            spdlog::error("failed to arm completion queue {:p}",
+                          reinterpret_cast<void *>(cq));
+            panic_with_errno();
+        }
+        armed = true;
+    }
+
+    //! \brief Reads and acknowledges all pending completion events without
+    //! blocking.
+    //!
+    //! \return The number of events consumed.
+    int consume_events() const {
+        RDMALIB2_ASSERT(channel);
+        int n = 0;
+        ibv_cq *ev_cq = nullptr;
+        void *ev_ctx = nullptr;
+        while (ibv_get_cq_event(channel, &ev_cq, &ev_ctx) == 0) {
+            ++n;
+        }
+        if (n > 0) {
+            ibv_ack_cq_events(cq, n);
+            armed = false;
+        }
+        return n;
+    }
+
+    //! \brief Switches count-only polls to the accelerated CQ interface,
+    //! which skips filling in work completions.
+    //!
+    //! `poll()`, `try_poll()` and `try_poll_length()` then only count
+    //! completions, so the CQ must not serve QPs with automatic selective
+    //! signaling, whose internal completions would never be retired. Polls
+    //! that return completions are unaffected.
+    //!
+    //! \return Whether the device supports the interface. If not, polls keep
+    //! using `ibv_poll_cq`.
+    bool enable_burst() {
+        RDMALIB2_ASSERT(!tracked);
+        if (burst) {
+            return true;
+        }
+
+        ibv_exp_query_intf_params params = {};
+        params.intf_scope = IBV_EXP_INTF_GLOBAL;
+        params.intf = IBV_EXP_INTF_CQ;
+        params.intf_version = 1;
+        params.obj = cq;
+
+        ibv_exp_query_intf_status status = IBV_EXP_INTF_STAT_OK;
+        auto *family = static_cast<ibv_exp_cq_family_v1 *>(
+            ibv_exp_query_intf(cq->context, &params, &status));
+        if (!family || status != IBV_EXP_INTF_STAT_OK) {
+            spdlog::trace("accelerated interface unavailable for completion "
+                          "queue {:p}: status {}",
+                          reinterpret_cast<void *>(cq),
+                          static_cast<int>(status));
+            return false;
+        }
+        burst = family;
+        return true;
+    }
+
+    bool is_burst_enabled() const { return burst != nullptr; }
+
+    //! \brief Records that a QP with automatic selective signaling sends
+    //! through this CQ, which rules out count-only polls from then on.
+    void mark_tracked() const {
+        RDMALIB2_ASSERT(!burst);
+        tracked = true;
+    }
+
+    bool is_tracked() const { return tracked; }
+
+    //! \brief Hands completions with an error status to `handler` instead of
+    //! panicking on them. Handled ones are left out of poll results.
+    //!
+    //! \return The previous handler, to which the new one may forward errors
+    //! it does not own.
+    error_handler_t set_error_handler(error_handler_t handler) {
+        return std::exchange(error_handler, std::move(handler));
+    }
+
+    //! \brief Polls the completion queue once only to retire the send queue
+    //! slots of tracked QPs.
+    //!
+    //! Completions that the caller asked for are deferred and returned by the
+    //! next polls in their original order.
+    void reap() const {
+        ibv_wc wc[kMaxPollCq] = {};
+        int n = do_poll_raw(kMaxPollCq, wc);
+        for (int i = 0; i < n; ++i) {
+            RDMALIB2_ASSERT(deferred_tail - deferred_head < deferred.size());
+            deferred[deferred_tail++ % deferred.size()] = wc[i];
+        }
+    }
+
     void poll(int num_entries = 1) const {
+        uint32_t idle = 0;
+        if (burst) {
+            while (num_entries) {
+                int n = do_poll_cnt(num_entries);
+                num_entries -= n;
+                on_poll(n, idle);
+            }
+            return;
+        }
+
         ibv_wc wc[kMaxPollCq] = {};
         while (num_entries) {
             int entries_to_poll = std::min(num_entries, kMaxPollCq);
             int n = do_poll(entries_to_poll, wc);
             num_entries -= n;
+            on_poll(n, idle);
         }
     }
 
     std::vector<rdma_success_cqe> poll_with_wc(int num_entries = 1) const {
         std::vector<rdma_success_cqe> ret{static_cast<size_t>(num_entries)};
+        poll_with_wc(std::span<rdma_success_cqe>{ret});
+        return ret;
+    }
+
+    //! \brief Polls until `out` is filled with completions.
+    //!
+    //! \return The number of completions harvested, i.e., `out.size()`.
+    int poll_with_wc(std::span<rdma_success_cqe> out) const {
+        int num_entries = static_cast<int>(out.size());
         ibv_wc wc[kMaxPollCq] = {};
+        uint32_t idle = 0;
         int tot = 0;
         while (tot < num_entries) {
             int entries_to_poll = std::min(num_entries - tot, kMaxPollCq);
             int n = do_poll(entries_to_poll, wc);
             for (int i = 0; i < n; ++i) {
-                ret[tot + i] = {
-                    rdma_success_cqe::to_op_type(wc[i].opcode),
-                    wc[i].wr_id,
-                    wc[i].byte_len,
-                    wc[i].imm_data,
-                };
+                out[tot + i] = rdma_success_cqe::from_wc(wc[i]);
             }
             tot += n;
+            on_poll(n, idle);
         }
-        return ret;
+        return tot;
+    }
+
+    //! \brief Polls until `num_entries` completions have been passed to
+    //! `callback`, one at a time.
+    //!
+    //! \return The number of completions harvested, i.e., `num_entries`.
+    template <typename F>
+        requires std::invocable<F &, rdma_success_cqe const &>
+    int poll_with_wc(F &&callback, int num_entries = 1) const {
+        ibv_wc wc[kMaxPollCq] = {};
+        uint32_t idle = 0;
+        int tot = 0;
+        while (tot < num_entries) {
+            int entries_to_poll = std::min(num_entries - tot, kMaxPollCq);
+            int n = do_poll(entries_to_poll, wc);
+            for (int i = 0; i < n; ++i) {
+                callback(rdma_success_cqe::from_wc(wc[i]));
+            }
+            tot += n;
+            on_poll(n, idle);
+        }
+        return tot;
     }
 
     int try_poll(int num_entries = 1) const {
+        if (burst) {
+            return do_poll_cnt(num_entries);
+        }
+
         ibv_wc wc[kMaxPollCq] = {};
         int ret = 0;
         while (ret < num_entries) {
             int entries_to_poll = std::min(num_entries - ret, kMaxPollCq);
-            int n = do_poll(num_entries, wc);
+            int n = do_poll(entries_to_poll, wc);
             ret += n;
             if (n < entries_to_poll) {
                 break;
@@ -123,62 +493,247 @@ public:
 
     std::vector<rdma_success_cqe> try_poll_with_wc(int num_entries = 1) const {
         std::vector<rdma_success_cqe> ret{static_cast<size_t>(num_entries)};
+        ret.resize(try_poll_with_wc(std::span<rdma_success_cqe>{ret}));
+        return ret;
+    }
+
+    //! \brief Polls for at most `out.size()` completions without waiting.
+    //!
+    //! \return The number of completions harvested into the front of `out`.
+    int try_poll_with_wc(std::span<rdma_success_cqe> out) const {
+        int num_entries = static_cast<int>(out.size());
         ibv_wc wc[kMaxPollCq] = {};
         int tot = 0;
         while (tot < num_entries) {
-            int entries_to_poll = std::min(num_entries, kMaxPollCq);
+            int entries_to_poll = std::min(num_entries - tot, kMaxPollCq);
             int n = do_poll(entries_to_poll, wc);
             for (int i = 0; i < n; ++i) {
-                ret[tot + i] = {
-                    rdma_success_cqe::to_op_type(wc[i].opcode),
-                    wc[i].wr_id,
-                    wc[i].byte_len,
-                    wc[i].imm_data,
-                };
+                out[tot + i] = rdma_success_cqe::from_wc(wc[i]);
             }
             tot += n;
             if (n < entries_to_poll) {
                 break;
             }
         }
-        ret.resize(tot);
-        ret.shrink_to_fit();
-        return ret;
+        return tot;
+    }
+
+    //! \brief Passes at most `num_entries` completions to `callback` without
+    //! waiting.
+    //!
+    //! \return The number of completions harvested.
+    template <typename F>
+        requires std::invocable<F &, rdma_success_cqe const &>
+    int try_poll_with_wc(F &&callback, int num_entries = 1) const {
+        ibv_wc wc[kMaxPollCq] = {};
+        int tot = 0;
+        while (tot < num_entries) {
+            int entries_to_poll = std::min(num_entries - tot, kMaxPollCq);
+            int n = do_poll(entries_to_poll, wc);
+            for (int i = 0; i < n; ++i) {
+                callback(rdma_success_cqe::from_wc(wc[i]));
+            }
+            tot += n;
+            if (n < entries_to_poll) {
+                break;
+            }
+        }
+        return tot;
+    }
+
+    //! \brief Polls for one receive completion and gets its byte length.
+    std::optional<uint32_t> try_poll_length() const {
+        if (burst && deferred_head == deferred_tail) {
+            int32_t len = burst->poll_length(cq, nullptr, nullptr);
+            if (unlikely(len < 0)) {
+                spdlog::error("poll completion queue {:p} failed with return "
+                              "value {}",
+                              reinterpret_cast<void *>(cq), len);
+                panic_with_errno();
+            }
+            return len ? std::make_optional(static_cast<uint32_t>(len))
+                       : std::nullopt;
+        }
+
+        ibv_wc wc = {};
+        return do_poll(1, &wc) ? std::make_optional(wc.byte_len)
+                               : std::nullopt;
     }
 
 protected:
+    template <uint32_t Features>
     static std::optional<ibv_cq *>
-    create_rdma_cq(rdma_context const &ctx, int cq_depth, void *cq_context) {
-        ibv_cq *cq = nullptr;
+    create_rdma_cq(rdma_context const &ctx, int cq_depth, void *cq_context,
+                   ibv_comp_channel *channel,
+                   cq_feature_base<Features> const &) {
+        ibv_exp_cq_init_attr init_attr = {};
         auto rd = ctx.get_res_domain();
         if (rd.has_value()) {
-            ibv_exp_cq_init_attr init_attr = {};
-            init_attr.comp_mask = IBV_EXP_CQ_INIT_ATTR_RES_DOMAIN;
+            init_attr.comp_mask |= IBV_EXP_CQ_INIT_ATTR_RES_DOMAIN;
             init_attr.res_domain = rd.value();
+        }
+
+        // Compressed CQE feature
+        if constexpr (Features & feature_compressed_cqe) {
+            init_attr.comp_mask |= IBV_EXP_CQ_INIT_ATTR_FLAGS;
+            init_attr.flags |= IBV_EXP_CQ_COMPRESSED_CQE;
+        }
+
+        ibv_cq *cq = nullptr;
+        if (init_attr.comp_mask) {
             cq = ibv_exp_create_cq(ctx.get_context(), cq_depth, cq_context,
-                                   nullptr, 0, &init_attr);
+                                   channel, 0, &init_attr);
         } else {
-            cq = ibv_create_cq(ctx.get_context(), cq_depth, cq_context, nullptr,
+            cq = ibv_create_cq(ctx.get_context(), cq_depth, cq_context, channel,
                                0);
         }
         return cq ? std::make_optional(cq) : std::nullopt;
     }
 
     int do_poll(int num_entries, ibv_wc *wc) const {
-        int ret = ibv_poll_cq(cq, num_entries, wc);
-        for (int i = 0; i < ret; ++i) {
+        int ret = 0;
+        if (unlikely(deferred_head != deferred_tail)) {
+            while (ret < num_entries && deferred_head != deferred_tail) {
+                wc[ret++] = deferred[deferred_head++ % deferred.size()];
+            }
+            if (ret == num_entries) {
+                return ret;
+            }
+        }
+        return ret + do_poll_raw(num_entries - ret, wc + ret);
+    }
+
+    static ibv_comp_channel *create_comp_channel(rdma_context const &ctx) {
+        ibv_comp_channel *channel = ibv_create_comp_channel(ctx.get_context());
+        if (!channel) {
+            spdlog::error("failed to create completion channel for context "
+                          "{:p}",
+                          reinterpret_cast<void const *>(ctx.get_context()));
+            panic_with_errno();
+        }
+
+        // Keep the fd usable with epoll; blocking waits go through poll(2)
+        int flags = fcntl(channel->fd, F_GETFL);
+        if (flags < 0 || fcntl(channel->fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+            spdlog::error("failed to make completion channel {:p} non-blocking",
+                          reinterpret_cast<void *>(channel));
+            panic_with_errno();
+        }
+        return channel;
+    }
+
+    //! \brief Accounts for one round of a blocking poll, sleeping on the
+    //! completion channel once the spin budget runs out.
+    void on_poll(int n, uint32_t &idle) const {
+        if (!channel) {
+            return;
+        }
+        if (n > 0) {
+            idle = 0;
+            return;
+        }
+        if (++idle < spin_budget) {
+            return;
+        }
+        idle = 0;
+
+        // Completions that arrived before arming raise no event, so poll
+        // once more after arming before actually sleeping
+        if (!armed) {
+            arm();
+            return;
+        }
+
+        pollfd pfd = {.fd = channel->fd, .events = POLLIN, .revents = 0};
+        if (::poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+            spdlog::error("failed to wait on completion channel {:p}",
+                          reinterpret_cast<void *>(channel));
+            panic_with_errno();
+        }
+        consume_events();
+    }
+
+    //! \brief Counts up to `num_entries` completions through the accelerated
+    //! interface, deferred ones first.
+    int do_poll_cnt(int num_entries) const {
+        int ret = 0;
+        while (unlikely(ret < num_entries && deferred_head != deferred_tail)) {
+            ++deferred_head;
+            ++ret;
+        }
+        if (ret == num_entries) {
+            return ret;
+        }
+
+        int32_t n = burst->poll_cnt(cq, num_entries - ret);
+        if (unlikely(n < 0)) {
+            spdlog::error("poll completion queue {:p} failed with return "
+                          "value {}",
+                          reinterpret_cast<void *>(cq), n);
+            panic_with_errno();
+        }
+        return ret + n;
+    }
+
+    //! \brief Polls the hardware completion queue, retiring and filtering
+    //! out completions tagged by send queue trackers.
+    int do_poll_raw(int num_entries, ibv_wc *wc) const {
+        int n = ibv_poll_cq(cq, num_entries, wc);
+        int ret = 0;
+        for (int i = 0; i < n; ++i) {
             if (unlikely(wc[i].status != IBV_WC_SUCCESS)) {
+                if (on_error(wc[i])) {
+                    continue;
+                }
                 spdlog::error("poll completion queue {:p} failed at <wr_id {}, "
                               "type {}> with status {}",
-                              reinterpret_cast<void *>(cq), i, wc[i].wr_id,
+                              reinterpret_cast<void *>(cq), wc[i].wr_id,
                               wc[i].opcode, wc[i].status);
                 panic_with_errno();
             }
+            if (rdma_sq_tracker::is_tagged(wc[i])) {
+                auto wr_id =
+                    rdma_sq_tracker::from_wr_id(wc[i].wr_id)->retire();
+                if (!wr_id.has_value()) {
+                    continue;
+                }
+                wc[i].wr_id = wr_id.value();
+            }
+            wc[ret++] = wc[i];
         }
         return ret;
     }
 
+    //! \brief Passes an error completion to the error handler, retiring it
+    //! first if it is tagged by a send queue tracker.
+    bool on_error(ibv_wc const &wc) const {
+        if (!error_handler) {
+            return false;
+        }
+        rdma_error_cqe cqe = {wc.wr_id, wc.status, wc.qp_num, wc.vendor_err};
+        if (rdma_sq_tracker::is_tagged(wc)) {
+            cqe.wr_id = rdma_sq_tracker::from_wr_id(wc.wr_id)->retire();
+        }
+        return error_handler(cqe);
+    }
+
     ibv_cq *cq = nullptr;
+
+    // Completions harvested by reap() but not yet returned to the caller
+    mutable std::vector<ibv_wc> deferred;
+    mutable size_t deferred_head = 0;
+    mutable size_t deferred_tail = 0;
+
+    ibv_exp_cq_family_v1 *burst = nullptr;
+    // Whether a tracked QP sends through this CQ
+    mutable bool tracked = false;
+
+    error_handler_t error_handler;
+
+    // Completion channel for sleeping when idle, if enabled
+    ibv_comp_channel *channel = nullptr;
+    uint32_t spin_budget = kCqSpinBudget;
+    mutable bool armed = false;
 };
 
 } // namespace rdmalib2
@@ -0,0 +1,251 @@
+#pragma once
+
+#ifndef __RDMALIB2_DC_H__
+#define __RDMALIB2_DC_H__
+
+#include "ah_cache.h"
+#include "context.h"
+#include "cq.h"
+#include "qp.h"
+#include "qp_config.h"
+#include "srq.h"
+#include "verb.h"
+#include <functional>
+#include <new>
+#include <optional>
+#include <vector>
+
+namespace rdmalib2 {
+
+//! \brief A Dynamically Connected target, which accepts verbs from any DC
+//! initiator that knows its number and key.
+//!
+//! Incoming sends consume receive work requests from the SRQ; one-sided verbs
+//! need the SRQ too, although they never consume from it. Receive completions
+//! go to `cq`.
+class rdma_dct {
+public:
+    struct info {
+        ibv_gid gid;
+        uint32_t lid;
+        uint32_t dct_num;
+    };
+
+    rdma_dct(rdma_context const &ctx, rdma_cq const &cq, rdma_srq const &srq,
+             uint8_t port = 1, uint64_t dc_key = kDcKey,
+             rdma_qp_config const &config = {})
+        : ctx(ctx), port(port) {
+        rdma_qp_config clamped =
+            config.clamp_to_device(ctx).clamp_to_port(ctx, port);
+        auto dct = create_rdma_dct(ctx, cq, srq, port, dc_key, clamped);
+        if (dct.has_value()) {
+            this->dct = dct.value();
+            spdlog::trace("created DC target {:p}, number {} on port {} for "
+                          "context {:p}",
+                          reinterpret_cast<void *>(this->dct),
+                          this->dct->dct_num, port,
+                          reinterpret_cast<void const *>(ctx.get_context()));
+        } else {
+            spdlog::error("failed to create DC target on port {} for context "
+                          "{:p}",
+                          port,
+                          reinterpret_cast<void const *>(ctx.get_context()));
+            panic_with_errno();
+        }
+    }
+
+    rdma_dct(rdma_dct const &) = delete;
+    rdma_dct &operator=(rdma_dct const &) = delete;
+
+    rdma_dct(rdma_dct &&other) noexcept
+        : ctx(other.ctx), port(other.port), dct(other.dct) {
+        other.dct = nullptr;
+    }
+
+    rdma_dct &operator=(rdma_dct &&other) & noexcept {
+        if (this != &other) {
+            this->~rdma_dct();
+            new (this) rdma_dct(std::move(other));
+        }
+        return *this;
+    }
+
+    ~rdma_dct() {
+        if (dct) {
+            spdlog::trace("destroying DC target {:p}",
+                          reinterpret_cast<void *>(dct));
+            ibv_exp_destroy_dct(dct);
+            dct = nullptr;
+        }
+    }
+
+    ibv_exp_dct *get_dct() const { return dct; }
+
+    uint32_t get_dct_num() const { return dct->dct_num; }
+
+    //! \brief Gets what initiators need to address this target, to be
+    //! exchanged out of band like `rdma_qp::info`.
+    info get_info() const {
+        return {ctx.get_gid(port), ctx.get_port_lid(port), dct->dct_num};
+    }
+
+protected:
+    static std::optional<ibv_exp_dct *>
+    create_rdma_dct(rdma_context const &ctx, rdma_cq const &cq,
+                    rdma_srq const &srq, uint8_t port, uint64_t dc_key,
+                    rdma_qp_config const &config) {
+        ibv_exp_dct_init_attr attr = {};
+        attr.pd = ctx.get_pd();
+        attr.cq = cq.get_cq();
+        attr.srq = srq.get_srq();
+        attr.dc_key = dc_key;
+        attr.port = port;
+        attr.access_flags = IBV_ACCESS_REMOTE_READ | IBV_ACCESS_REMOTE_WRITE |
+                            IBV_ACCESS_REMOTE_ATOMIC;
+        attr.min_rnr_timer = config.min_rnr_timer;
+        attr.mtu = config.path_mtu;
+        attr.pkey_index = 0;
+        attr.gid_index = rdma_context::universal_gid_index;
+        attr.hop_limit = 0xFF;
+
+        ibv_exp_dct *dct = ibv_exp_create_dct(ctx.get_context(), &attr);
+        return dct ? std::make_optional(dct) : std::nullopt;
+    }
+
+    rdma_context const &ctx;
+    uint8_t port;
+    ibv_exp_dct *dct = nullptr;
+};
+
+//! \brief A pool of DC initiators, through which one node reaches any number
+//! of DC targets without a QP per target.
+//!
+//! A DCI connects to the target of each work request on the fly, and
+//! switching targets costs a reconnection in hardware, so verbs to the same
+//! target always go through the same DCI, picked by the target number. This
+//! also keeps them ordered. Completions of all DCIs go to `send_cq`.
+//!
+//! An unreachable target moves its DCI to the error state, which would stall
+//! every other target behind it. The pool takes over the error completions of
+//! its DCIs on `send_cq`, passes them to the failure handler and recovers the
+//! DCI before the next verb is posted to it. Recovery discards the verbs still
+//! outstanding on the DCI, so with automatic selective signaling their flushed
+//! completions must be polled before posting to it again.
+//!
+//! Target addresses share a cache of `ah_capacity` address handles, which
+//! should cover the targets in use at once to avoid re-creating them.
+class rdma_dci_pool {
+public:
+    //! Called with every error completion of the pool's DCIs, e.g., to fail
+    //! or retry the verb
+    using failure_handler_t = std::function<void(rdma_error_cqe const &)>;
+
+    rdma_dci_pool(rdma_context const &ctx, rdma_cq &send_cq,
+                  size_t num_dcis = kDciPoolSize,
+                  rdma_qp_config const &config = {}, uint8_t port = 1,
+                  size_t ah_capacity = kAhCacheSize)
+        : send_cq(send_cq), ahs(ctx, ah_capacity, port),
+          failed(num_dcis, false) {
+        RDMALIB2_ASSERT(num_dcis > 0);
+        dcis.reserve(num_dcis);
+        for (size_t i = 0; i < num_dcis; ++i) {
+            dcis.emplace_back(ctx, send_cq, config);
+            dcis.back().bind_port(port);
+        }
+        // Errors of other QPs on the CQ go to the handler installed before
+        prev_handler = send_cq.set_error_handler(
+            [this](rdma_error_cqe const &cqe) { return on_error(cqe); });
+    }
+
+    // The send CQ calls back into the pool on errors
+    rdma_dci_pool(rdma_dci_pool const &) = delete;
+    rdma_dci_pool &operator=(rdma_dci_pool const &) = delete;
+
+    rdma_dci_pool(rdma_dci_pool &&) = delete;
+    rdma_dci_pool &operator=(rdma_dci_pool &&) = delete;
+
+    //! Pools sharing a CQ must be destroyed in reverse order of creation.
+    ~rdma_dci_pool() { send_cq.set_error_handler(std::move(prev_handler)); }
+
+    size_t size() const { return dcis.size(); }
+
+    rdma_dc_qp &get(size_t i) { return dcis[i]; }
+
+    //! \brief Gets the DCI that carries every verb to a target.
+    rdma_dc_qp &get_dci(uint32_t dct_number) {
+        return dcis[dct_number % dcis.size()];
+    }
+
+    //! \brief Gets the destination of a remote DC target, which pins its
+    //! address handle while held or set on a verb.
+    rdma_dc_dest get_dest(rdma_dct::info const &remote,
+                          uint64_t dc_key = kDcKey) {
+        auto ah = ahs.get(remote.gid, remote.lid);
+        return {ah.get(), remote.dct_num, dc_key, std::move(ah)};
+    }
+
+    //! \brief Sets the handler of failed verbs. Without one, failures are
+    //! only logged.
+    void set_failure_handler(failure_handler_t handler) {
+        on_failure = std::move(handler);
+    }
+
+    //! \brief Posts a send verb to a DC target through its DCI, recovering
+    //! the DCI first if one of its verbs failed.
+    template <typename Tag, uint32_t MaxSge>
+    void post_verb(rdma_verb<Tag, MaxSge> &verb, rdma_dc_dest const &dest) {
+        size_t i = dest.dct_number % dcis.size();
+        if (unlikely(failed[i])) {
+            failed[i] = false;
+            dcis[i].recover();
+        }
+        verb.set_dc_dest(dest);
+        dcis[i].post_verb(verb);
+    }
+
+    //! \brief Brings every DCI that hit a transport error back to RTS, e.g.,
+    //! after a target went away.
+    //!
+    //! \return The number of DCIs recovered.
+    size_t recover() {
+        size_t ret = 0;
+        for (size_t i = 0; i < dcis.size(); ++i) {
+            failed[i] = false;
+            ret += dcis[i].recover();
+        }
+        return ret;
+    }
+
+protected:
+    bool on_error(rdma_error_cqe const &cqe) {
+        for (size_t i = 0; i < dcis.size(); ++i) {
+            if (dcis[i].get_qp()->qp_num != cqe.qp_num) {
+                continue;
+            }
+            failed[i] = true;
+            if (on_failure) {
+                on_failure(cqe);
+            } else {
+                spdlog::warn("verb <wr_id {}> on DC initiator {:p} failed "
+                             "with status {}",
+                             cqe.wr_id.value_or(0),
+                             reinterpret_cast<void *>(dcis[i].get_qp()),
+                             static_cast<int>(cqe.status));
+            }
+            return true;
+        }
+        return prev_handler && prev_handler(cqe);
+    }
+
+    rdma_cq &send_cq;
+    rdma_cq::error_handler_t prev_handler;
+    failure_handler_t on_failure;
+    rdma_ah_cache ahs;
+    std::vector<rdma_dc_qp> dcis;
+    // Whether each DCI reported an error since it was last recovered
+    std::vector<bool> failed;
+};
+
+} // namespace rdmalib2
+
+#endif // __RDMALIB2_DC_H__
@@ -0,0 +1,108 @@
+#pragma once
+
+#ifndef __RDMALIB2_DEMUX_H__
+#define __RDMALIB2_DEMUX_H__
+
+#include "cq.h"
+#include "qp.h"
+#include <functional>
+#include <unordered_map>
+
+namespace rdmalib2 {
+
+//! \brief Demultiplexes the completions of a CQ shared by many QPs to
+//! per-QP handlers, keyed by QP number.
+//!
+//! One shared CQ per polling thread keeps the polling cost proportional to
+//! the traffic instead of to the number of connections. Handlers are
+//! registered and removed off the hot path; dispatching a completion is a
+//! hash lookup, skipped when consecutive completions belong to the same QP.
+//! A handler must not detach its own QP.
+class rdma_cq_demux {
+public:
+    using handler_t = std::function<void(rdma_success_cqe const &)>;
+
+    explicit rdma_cq_demux(rdma_cq const &cq) : cq(cq) {}
+
+    // Cached handler pointers refer into the demultiplexer
+    rdma_cq_demux(rdma_cq_demux const &) = delete;
+    rdma_cq_demux &operator=(rdma_cq_demux const &) = delete;
+
+    rdma_cq_demux(rdma_cq_demux &&) = delete;
+    rdma_cq_demux &operator=(rdma_cq_demux &&) = delete;
+
+    ~rdma_cq_demux() = default;
+
+    rdma_cq const &get_cq() const { return cq; }
+
+    size_t get_num_qps() const { return handlers.size(); }
+
+    //! \brief Routes the completions of a QP to `handler`.
+    template <ibv_qp_type Type>
+    rdma_cq_demux &attach(rdma_qp<Type> const &qp, handler_t handler) {
+        return attach(qp.get_qp()->qp_num, std::move(handler));
+    }
+
+    rdma_cq_demux &attach(uint32_t qp_num, handler_t handler) {
+        auto [it, inserted] = handlers.emplace(qp_num, std::move(handler));
+        if (!inserted) {
+            spdlog::error("QP {} is already attached to completion queue "
+                          "demultiplexer {:p}",
+                          qp_num, reinterpret_cast<void *>(this));
+            panic();
+        }
+        return *this;
+    }
+
+    template <ibv_qp_type Type>
+    rdma_cq_demux &detach(rdma_qp<Type> const &qp) {
+        return detach(qp.get_qp()->qp_num);
+    }
+
+    rdma_cq_demux &detach(uint32_t qp_num) {
+        handlers.erase(qp_num);
+        if (qp_num == last_qp_num) {
+            last_handler = nullptr;
+        }
+        return *this;
+    }
+
+    //! \brief Polls at most `num_entries` completions without waiting and
+    //! passes each of them to the handler of its QP.
+    //!
+    //! \return The number of completions harvested.
+    int poll(int num_entries = kMaxPollCq) {
+        return cq.try_poll_with_wc(
+            [this](rdma_success_cqe const &cqe) { dispatch(cqe); },
+            num_entries);
+    }
+
+    //! \brief Passes a completion to the handler of its QP.
+    void dispatch(rdma_success_cqe const &cqe) {
+        if (unlikely(!last_handler || cqe.qp_num != last_qp_num)) {
+            auto it = handlers.find(cqe.qp_num);
+            if (unlikely(it == handlers.end())) {
+                spdlog::error("completion <wr_id {}> of QP {} has no handler "
+                              "in completion queue demultiplexer {:p}",
+                              cqe.wr_id, cqe.qp_num,
+                              reinterpret_cast<void *>(this));
+                panic();
+            }
+            last_qp_num = cqe.qp_num;
+            last_handler = &it->second;
+        }
+        (*last_handler)(cqe);
+    }
+
+protected:
+    rdma_cq const &cq;
+    std::unordered_map<uint32_t, handler_t> handlers;
+
+    // Handler of the QP that completed last
+    uint32_t last_qp_num = 0;
+    handler_t *last_handler = nullptr;
+};
+
+} // namespace rdmalib2
+
+#endif // __RDMALIB2_DEMUX_H__
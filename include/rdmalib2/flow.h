@@ -0,0 +1,236 @@
+#pragma once
+
+#ifndef __RDMALIB2_FLOW_H__
+#define __RDMALIB2_FLOW_H__
+
+#include "batch.h"
+#include "context.h"
+#include "mem.h"
+#include "qp.h"
+#include "verb.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <optional>
+
+namespace rdmalib2 {
+
+//! \brief Credit-based flow control of the verbs that consume receives of
+//! the peer over an RC QP, i.e., sends and writes with immediate data.
+//!
+//! Every posted receive grants the peer one credit. Each side exposes an
+//! 8-byte counter of the credits granted to it, which the peer advances with
+//! a small inline RDMA write of its running total whenever it has re-posted
+//! `grant_batch` receives. A verb is only posted while the peer has a receive
+//! waiting for it and the send queue has a free slot, so sends never run into
+//! RNR retries nor overflow the send queue: `try_send()` pushes back when
+//! either runs out, while `send()` queues the verb locally, in order, until
+//! `progress()` finds credits and slots again. Reads, writes and atomics may
+//! go through the same path to keep their order with sends; they only wait
+//! for a send queue slot.
+//!
+//! The QP must have automatic selective signaling enabled, which tracks the
+//! free send queue slots, and the send CQ must be polled for slots to free
+//! up. Memory referenced by a queued verb, including payloads to be inlined,
+//! must stay valid until the verb is posted.
+class rdma_credit_flow {
+public:
+    //! \brief What the peer needs to grant credits, to be exchanged out of
+    //! band like `rdma_qp::info`.
+    struct info {
+        uint64_t addr;
+        uint32_t rkey;
+        uint32_t initial_credits;
+    };
+
+    //! \param initial_recvs The number of receives posted before connecting,
+    //! which the peer starts out with as credits.
+    //! \param grant_batch The number of re-posted receives to accumulate
+    //! before granting them; 0 picks a quarter of `initial_recvs`.
+    rdma_credit_flow(rdma_context const &ctx, rdma_rc_qp const &qp,
+                     uint32_t initial_recvs, uint32_t grant_batch = 0)
+        : qp(qp),
+          granted_region(ctx, static_cast<void *>(&granted), sizeof(granted)),
+          initial_recvs(initial_recvs),
+          grant_batch(grant_batch > 0 ? grant_batch
+                                      : std::max(initial_recvs / 4, 1u)) {
+        RDMALIB2_ASSERT(qp.get_sq_tracker());
+    }
+
+    // The peer writes into this object
+    rdma_credit_flow(rdma_credit_flow const &) = delete;
+    rdma_credit_flow &operator=(rdma_credit_flow const &) = delete;
+
+    rdma_credit_flow(rdma_credit_flow &&) = delete;
+    rdma_credit_flow &operator=(rdma_credit_flow &&) = delete;
+
+    ~rdma_credit_flow() = default;
+
+    info get_info() const {
+        return {reinterpret_cast<uint64_t>(&granted),
+                granted_region.get_rkey(), initial_recvs};
+    }
+
+    rdma_credit_flow &connect(info const &remote) {
+        initial_credits = remote.initial_credits;
+        grant_verb.add_unregistered_entry(&grant_total, sizeof(grant_total))
+            .set_remote_memory(
+                {remote.addr, sizeof(uint64_t), remote.rkey});
+        return *this;
+    }
+
+    //! \brief Gets the number of verbs that can be posted before the peer
+    //! grants more credits.
+    uint64_t get_credits() const {
+        uint64_t total =
+            initial_credits + granted.load(std::memory_order_acquire);
+        return total - consumed;
+    }
+
+    //! \brief Gets the number of verbs queued by `send()`.
+    size_t get_num_queued() const { return queued.size(); }
+
+    //! \brief Posts a verb if a send queue slot is available, as well as a
+    //! credit if the verb consumes a receive of the peer, and nothing is
+    //! queued ahead of it.
+    //!
+    //! \return False if the verb has to wait.
+    template <typename Tag, uint32_t MaxSge>
+    bool try_send(rdma_verb<Tag, MaxSge> &verb) {
+        bool needs_credit = consumes_recv(verb.get_op());
+        if (!queued.empty() || (needs_credit && get_credits() == 0) ||
+            qp.get_sq_tracker()->get_available() == 0) {
+            return false;
+        }
+        qp.post_verb(verb);
+        consumed += needs_credit;
+        return true;
+    }
+
+    //! \brief Posts a verb, or queues it locally if it has to wait.
+    template <typename Tag, uint32_t MaxSge>
+    void send(rdma_verb<Tag, MaxSge> &verb) {
+        static_assert(MaxSge <= kMaxSge,
+                      "queued verbs hold at most kMaxSge SGEs");
+        progress();
+        if (try_send(verb)) {
+            return;
+        }
+
+        auto const &wr =
+            verb.get_wr(qp.is_auto_inline(), qp.get_max_inline_data());
+        entry &e = queued.emplace_back();
+        e.wr = wr;
+        e.wr.next = nullptr;
+        RDMALIB2_ASSERT(static_cast<uint32_t>(wr.num_sge) <= kMaxSge);
+        std::copy_n(wr.sg_list, wr.num_sge, e.sgl);
+        e.wr_id = verb.get_id();
+        e.notified = verb.is_notified();
+        e.needs_credit = consumes_recv(verb.get_op());
+    }
+
+    //! \brief Posts as many queued verbs as credits and send queue slots
+    //! allow, with a single doorbell per `kFlowFlushBatch` verbs.
+    //!
+    //! \return The number of verbs posted.
+    size_t progress() {
+        size_t ret = 0;
+        while (!queued.empty()) {
+            uint64_t credits = get_credits();
+            uint64_t limit = std::min<uint64_t>(
+                qp.get_sq_tracker()->get_available(), kFlowFlushBatch);
+            uint64_t n = 0;
+            uint64_t charged = 0;
+            while (n < limit && !queued.empty()) {
+                entry const &e = queued.front();
+                if (e.needs_credit && charged == credits) {
+                    break;
+                }
+                fill(n++, e);
+                charged += e.needs_credit;
+                queued.pop_front();
+            }
+            if (n == 0) {
+                break;
+            }
+            batch.set_size(n);
+            qp.post_verb(batch);
+            consumed += charged;
+            ret += n;
+        }
+        return ret;
+    }
+
+    //! \brief Grants the peer credits for `n` receives re-posted after
+    //! connecting, writing them back once `grant_batch` have accumulated.
+    void grant(uint32_t n) {
+        reposted += n;
+        if (reposted - grant_total >= grant_batch) {
+            flush_grants();
+        }
+    }
+
+    //! \brief Writes back every credit granted so far right away.
+    void flush_grants() {
+        if (reposted == grant_total) {
+            return;
+        }
+        // The payload is inlined, so it is copied before posting returns
+        grant_total = reposted;
+        qp.post_verb(grant_verb);
+    }
+
+protected:
+    struct entry {
+        ibv_exp_send_wr wr;
+        ibv_sge sgl[kMaxSge];
+        uint64_t wr_id;
+        bool notified;
+        bool needs_credit;
+    };
+
+    //! \brief Checks whether a verb consumes a receive of the peer, and thus
+    //! a credit. Reads, writes and atomics only need a send queue slot.
+    static bool consumes_recv(std::optional<ibv_exp_wr_opcode> op) {
+        RDMALIB2_ASSERT(op.has_value());
+        return op == IBV_EXP_WR_SEND || op == IBV_EXP_WR_SEND_WITH_IMM ||
+               op == IBV_EXP_WR_RDMA_WRITE_WITH_IMM;
+    }
+
+    //! \brief Copies a queued verb into slot `i` of the batch, keeping the
+    //! batch's own list links.
+    void fill(size_t i, entry const &e) {
+        ibv_exp_send_wr &wr = batch.get_wr(i);
+        ibv_sge *sgl = wr.sg_list;
+        ibv_exp_send_wr *next = wr.next;
+        wr = e.wr;
+        wr.sg_list = sgl;
+        wr.next = next;
+        std::copy_n(e.sgl, e.wr.num_sge, sgl);
+        batch.set_id(i, e.wr_id).set_notify(i, e.notified);
+    }
+
+    rdma_rc_qp const &qp;
+
+    // Credits granted by the peer beyond the initial ones, written by the
+    // peer's NIC
+    std::atomic<uint64_t> granted{0};
+    rdma_memory_region granted_region;
+
+    // Sender side
+    uint64_t initial_credits = 0;
+    uint64_t consumed = 0;
+    std::deque<entry> queued;
+    rdma_verb_batch<kFlowFlushBatch, kMaxSge> batch;
+
+    // Receiver side
+    uint32_t initial_recvs;
+    uint32_t grant_batch;
+    uint64_t reposted = 0;
+    uint64_t grant_total = 0;
+    rdma_write grant_verb;
+};
+
+} // namespace rdmalib2
+
+#endif // __RDMALIB2_FLOW_H__
@@ -0,0 +1,295 @@
+#pragma once
+
+#ifndef __RDMALIB2_POOL_H__
+#define __RDMALIB2_POOL_H__
+
+#include "context.h"
+#include "cq.h"
+#include "qp.h"
+#include "qp_config.h"
+#include "verb.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace rdmalib2 {
+
+//! \brief A pool of RC QPs to one remote endpoint, split into lanes that each
+//! belong to a single worker thread.
+//!
+//! Every lane owns its send and receive CQs and `qps_per_lane` QPs on them,
+//! so threads never share a QP or a CQ and the post path takes no lock; the
+//! context may then use the `rdma_context::thread_unsafe` hint. Within a
+//! lane, `post_verb()` stripes verbs across the QPs in turn, which spreads a
+//! single thread's load over more of the NIC's processing units at the cost
+//! of ordering between verbs.
+class rdma_qp_pool {
+public:
+    class lane {
+    public:
+        lane(rdma_context const &ctx, size_t num_qps,
+             rdma_qp_config const &config)
+            : send_cq(ctx, static_cast<int>(num_qps) * config.depth),
+              recv_cq(ctx, static_cast<int>(num_qps) * config.depth) {
+            RDMALIB2_ASSERT(num_qps > 0);
+            qps.reserve(num_qps);
+            for (size_t i = 0; i < num_qps; ++i) {
+                qps.emplace_back(ctx, send_cq, recv_cq, config,
+                                 rdma_rc_qp::extended_atomics);
+            }
+        }
+
+        // QPs refer to the CQs of the lane
+        lane(lane const &) = delete;
+        lane &operator=(lane const &) = delete;
+
+        lane(lane &&) = delete;
+        lane &operator=(lane &&) = delete;
+
+        ~lane() = default;
+
+        rdma_cq const &get_send_cq() const { return send_cq; }
+        rdma_cq const &get_recv_cq() const { return recv_cq; }
+
+        size_t size() const { return qps.size(); }
+
+        rdma_rc_qp &get(size_t i) { return qps[i]; }
+
+        //! \brief Gets the QP that the next striped verb goes to.
+        rdma_rc_qp &next() {
+            rdma_rc_qp &qp = qps[cursor];
+            cursor = cursor + 1 < qps.size() ? cursor + 1 : 0;
+            return qp;
+        }
+
+        //! \brief Posts a verb to the next QP of the lane.
+        template <typename Tag, uint32_t MaxSge>
+        void post_verb(rdma_verb<Tag, MaxSge> &verb) {
+            next().post_verb(verb);
+        }
+
+        //! \brief Posts a batch to the next QP of the lane, keeping the batch
+        //! in order and behind a single doorbell.
+        template <size_t N, uint32_t MaxSge>
+        void post_verb(rdma_verb_batch<N, MaxSge> &batch) {
+            next().post_verb(batch);
+        }
+
+    protected:
+        rdma_cq send_cq;
+        rdma_cq recv_cq;
+        std::vector<rdma_rc_qp> qps;
+        size_t cursor = 0;
+    };
+
+    rdma_qp_pool(rdma_context const &ctx, size_t num_lanes,
+                 size_t qps_per_lane = 1, rdma_qp_config const &config = {})
+        : id(next_id.fetch_add(1, std::memory_order_relaxed)),
+          free_list(std::make_shared<free_lanes>()) {
+        RDMALIB2_ASSERT(num_lanes > 0);
+        lanes.reserve(num_lanes);
+        for (size_t i = 0; i < num_lanes; ++i) {
+            lanes.push_back(std::make_unique<lane>(ctx, qps_per_lane, config));
+        }
+        // Hand out lanes in order
+        free_list->indices.reserve(num_lanes);
+        for (size_t i = num_lanes; i > 0; --i) {
+            free_list->indices.push_back(i - 1);
+        }
+        spdlog::trace("created QP pool {} with {} lane(s) of {} QP(s)", id,
+                      num_lanes, qps_per_lane);
+    }
+
+    // Threads hold on to their lanes
+    rdma_qp_pool(rdma_qp_pool const &) = delete;
+    rdma_qp_pool &operator=(rdma_qp_pool const &) = delete;
+
+    rdma_qp_pool(rdma_qp_pool &&) = delete;
+    rdma_qp_pool &operator=(rdma_qp_pool &&) = delete;
+
+    ~rdma_qp_pool() = default;
+
+    size_t get_num_lanes() const { return lanes.size(); }
+
+    lane &get_lane(size_t i) { return *lanes[i]; }
+
+    //! \brief Gets the lane of the calling thread, handing out a free lane
+    //! on its first call.
+    //!
+    //! The lane goes back to the pool when the thread exits or calls
+    //! `release_local_lane()`, so a pool serves any number of short-lived
+    //! threads as long as at most `get_num_lanes()` hold a lane at once.
+    lane &local_lane() {
+        auto &entries = local_claims().entries;
+        for (auto const &c : entries) {
+            if (c.pool_id == id) {
+                return *c.l;
+            }
+        }
+
+        size_t i = 0;
+        {
+            std::lock_guard<std::mutex> lock(free_list->mutex);
+            if (unlikely(free_list->indices.empty())) {
+                spdlog::error("QP pool {} has no lane left among its {} for "
+                              "another thread",
+                              id, lanes.size());
+                panic();
+            }
+            i = free_list->indices.back();
+            free_list->indices.pop_back();
+        }
+        // Forget the lanes of pools that are gone
+        std::erase_if(entries,
+                      [](claim const &c) { return c.free_list.expired(); });
+        entries.push_back({id, free_list, i, lanes[i].get()});
+        return *lanes[i];
+    }
+
+    //! \brief Returns the lane of the calling thread to the pool before the
+    //! thread exits. Completions still pending on the lane's CQs go with it
+    //! to the next thread, so they should be polled first.
+    void release_local_lane() {
+        auto &entries = local_claims().entries;
+        auto it = std::find_if(
+            entries.begin(), entries.end(),
+            [this](claim const &c) { return c.pool_id == id; });
+        if (it != entries.end()) {
+            it->give_back();
+            entries.erase(it);
+        }
+    }
+
+    //! \brief Calls `f` with every QP of the pool, e.g., to connect them all
+    //! through `cm::connect()`.
+    template <typename F> rdma_qp_pool &for_each_qp(F &&f) {
+        for (auto &l : lanes) {
+            for (size_t i = 0; i < l->size(); ++i) {
+                f(l->get(i));
+            }
+        }
+        return *this;
+    }
+
+protected:
+    // Lanes held by no thread. Threads refer to it weakly, so that one
+    // exiting after the pool is gone has nothing to give back.
+    struct free_lanes {
+        std::mutex mutex;
+        std::vector<size_t> indices;
+    };
+
+    struct claim {
+        // Keyed by pool id rather than address, which may be reused
+        uint64_t pool_id;
+        std::weak_ptr<free_lanes> free_list;
+        size_t index;
+        lane *l;
+
+        void give_back() const {
+            if (auto f = free_list.lock()) {
+                std::lock_guard<std::mutex> lock(f->mutex);
+                f->indices.push_back(index);
+            }
+        }
+    };
+
+    // The lanes a thread holds, returned when it exits
+    struct claims {
+        std::vector<claim> entries;
+
+        ~claims() {
+            for (auto const &c : entries) {
+                c.give_back();
+            }
+        }
+    };
+
+    static claims &local_claims() {
+        thread_local claims c;
+        return c;
+    }
+
+    static inline std::atomic<uint64_t> next_id{0};
+
+    uint64_t id;
+    std::vector<std::unique_ptr<lane>> lanes;
+    std::shared_ptr<free_lanes> free_list;
+};
+
+//! \brief A stock of pre-created QPs in RESET state, so that establishing a
+//! connection only costs the state transitions instead of creating a QP,
+//! which takes milliseconds.
+//!
+//! QPs taken with `acquire()` are connected as usual; handing them back with
+//! `release()` resets them for the next connection. All QPs share the CQs
+//! given at construction.
+template <ibv_qp_type Type> class rdma_warm_qp_pool {
+public:
+    template <typename Features>
+    rdma_warm_qp_pool(rdma_context const &ctx, rdma_cq const &send_cq,
+                      rdma_cq const &recv_cq, size_t size,
+                      rdma_qp_config const &config, Features const &features)
+        : create_qp([&ctx, &send_cq, &recv_cq, config, features] {
+              return rdma_qp<Type>(ctx, send_cq, recv_cq, config, features);
+          }) {
+        refill(size);
+    }
+
+    rdma_warm_qp_pool(rdma_context const &ctx, rdma_cq const &send_cq,
+                      rdma_cq const &recv_cq, size_t size,
+                      rdma_qp_config const &config = {})
+        : rdma_warm_qp_pool(ctx, send_cq, recv_cq, size, config,
+                            rdma_qp<Type>::no_features) {}
+
+    rdma_warm_qp_pool(rdma_warm_qp_pool const &) = delete;
+    rdma_warm_qp_pool &operator=(rdma_warm_qp_pool const &) = delete;
+
+    rdma_warm_qp_pool(rdma_warm_qp_pool &&) = delete;
+    rdma_warm_qp_pool &operator=(rdma_warm_qp_pool &&) = delete;
+
+    ~rdma_warm_qp_pool() = default;
+
+    //! \brief Gets the number of QPs ready to be acquired.
+    size_t size() const { return qps.size(); }
+
+    //! \brief Creates QPs until `size` are ready, e.g., off the critical path
+    //! after a burst of connections.
+    void refill(size_t size) {
+        qps.reserve(size);
+        while (qps.size() < size) {
+            qps.push_back(create_qp());
+        }
+    }
+
+    //! \brief Takes a QP in RESET state, creating one if the pool is empty.
+    rdma_qp<Type> acquire() {
+        if (unlikely(qps.empty())) {
+            spdlog::warn("warm QP pool {:p} is empty, creating a QP",
+                         reinterpret_cast<void *>(this));
+            return create_qp();
+        }
+        rdma_qp<Type> qp = std::move(qps.back());
+        qps.pop_back();
+        return qp;
+    }
+
+    //! \brief Resets a QP whose connection is over and keeps it for later.
+    //! Its completions must have been polled already.
+    void release(rdma_qp<Type> &&qp) {
+        qp.reset();
+        qps.push_back(std::move(qp));
+    }
+
+protected:
+    std::function<rdma_qp<Type>()> create_qp;
+    std::vector<rdma_qp<Type>> qps;
+};
+
+} // namespace rdmalib2
+
+#endif // __RDMALIB2_POOL_H__
@@ -5,9 +5,17 @@
 
 #include "../context.h"
 #include "../cq.h"
+#include "../qp_config.h"
+#include "../srq.h"
+#include "../xrc.h"
+#include <algorithm>
+#include <iterator>
+#include <memory>
 #include <new>
 #include <optional>
+#include <random>
 #include <string>
+#include <tuple>
 
 namespace rdmalib2 {
 
@@ -33,8 +41,18 @@ static inline std::string qptype_to_string(ibv_qp_type type) {
     }
 }
 
-// Predeclaration of rdma_verb class
-template <typename Wr> class rdma_verb;
+// Predeclaration of rdma_verb and rdma_verb_batch classes
+template <typename Wr, uint32_t MaxSge> class rdma_verb;
+template <size_t N, uint32_t MaxSge> class rdma_verb_batch;
+
+//! \brief What a remote QP needs to connect to or address a QP. It is shared
+//! by all QP types, since XRC send and receive QPs connect to each other.
+struct rdma_qp_info {
+    ibv_gid gid;
+    uint32_t lid;
+    uint32_t qp_num;
+    uint32_t psn;
+};
 
 template <ibv_qp_type Type> class rdma_qp {
 protected:
@@ -51,54 +69,140 @@ protected:
     };
 
 public:
-    struct info {
-        ibv_gid gid;
-        uint32_t lid;
-        uint32_t qp_num;
-        uint32_t psn;
-    };
+    using info = rdma_qp_info;
 
+    //! \brief Gets what the remote QP needs for the next `connect()` or
+    //! `reconnect()`, including the random PSN this QP will start from.
     info get_info() const {
-        return {ctx.get_gid(), ctx.get_port_lid(port), qp->qp_num,
-                universal_init_psn};
+        return {ctx.get_gid(port), ctx.get_port_lid(port), qp->qp_num, psn};
     }
 
 public:
+    template <uint32_t C, uint32_t F>
+    rdma_qp(rdma_context const &ctx, rdma_cq const &send_cq,
+            rdma_cq const &recv_cq, rdma_qp_config const &config,
+            qp_feature_base<C, F> const &features)
+        : rdma_qp(ctx, &send_cq, &recv_cq, nullptr, nullptr, config,
+                  features) {}
+
+    rdma_qp(rdma_context const &ctx, rdma_cq const &send_cq,
+            rdma_cq const &recv_cq, rdma_qp_config const &config)
+        : rdma_qp(ctx, send_cq, recv_cq, config, no_features) {}
+
     template <uint32_t C, uint32_t F>
     rdma_qp(rdma_context const &ctx, rdma_cq const &send_cq,
             rdma_cq const &recv_cq, int qp_depth,
             qp_feature_base<C, F> const &features)
-        : ctx(ctx) {
-        static_assert(Type != IBV_QPT_XRC_SEND, "XRC not implemented");
-        static_assert(Type != IBV_QPT_XRC_RECV, "XRC not implemented");
-        static_assert(Type != IBV_EXP_QPT_DC_INI, "DC QP not implemented");
+        : rdma_qp(ctx, send_cq, recv_cq, depth_config(qp_depth), features) {}
+
+    rdma_qp(rdma_context const &ctx, rdma_cq const &send_cq,
+            rdma_cq const &recv_cq, int qp_depth = kQpDepth)
+        : rdma_qp(ctx, send_cq, recv_cq, qp_depth, no_features) {}
+
+    //! \brief Creates a QP that takes its receive work requests from a shared
+    //! receive queue instead of a private one.
+    template <uint32_t C, uint32_t F>
+    rdma_qp(rdma_context const &ctx, rdma_cq const &send_cq,
+            rdma_cq const &recv_cq, rdma_srq const &srq,
+            rdma_qp_config const &config,
+            qp_feature_base<C, F> const &features)
+        : rdma_qp(ctx, &send_cq, &recv_cq, srq.get_srq(), nullptr, config,
+                  features) {}
 
-        auto qp = create_rdma_qp(ctx, qp_depth, send_cq, recv_cq, features);
+    rdma_qp(rdma_context const &ctx, rdma_cq const &send_cq,
+            rdma_cq const &recv_cq, rdma_srq const &srq,
+            rdma_qp_config const &config)
+        : rdma_qp(ctx, send_cq, recv_cq, srq, config, no_features) {}
+
+    template <uint32_t C, uint32_t F>
+    rdma_qp(rdma_context const &ctx, rdma_cq const &send_cq,
+            rdma_cq const &recv_cq, rdma_srq const &srq, int qp_depth,
+            qp_feature_base<C, F> const &features)
+        : rdma_qp(ctx, send_cq, recv_cq, srq, depth_config(qp_depth),
+                  features) {}
+
+    rdma_qp(rdma_context const &ctx, rdma_cq const &send_cq,
+            rdma_cq const &recv_cq, rdma_srq const &srq,
+            int qp_depth = kQpDepth)
+        : rdma_qp(ctx, send_cq, recv_cq, srq, qp_depth, no_features) {}
+
+    //! \brief Creates a send-only QP, i.e., an XRC send QP or a DC initiator.
+    rdma_qp(rdma_context const &ctx, rdma_cq const &send_cq,
+            rdma_qp_config const &config = {})
+        : rdma_qp(ctx, &send_cq, &send_cq, nullptr, nullptr, config,
+                  no_features) {
+        static_assert(Type == IBV_QPT_XRC_SEND || Type == IBV_EXP_QPT_DC_INI,
+                      "only XRC send QPs and DC initiators are send-only");
+    }
+
+    //! \brief Creates an XRC receive QP in `xrcd`. It has neither queues nor
+    //! CQs of its own: each message lands in the XRC SRQ of the domain that
+    //! the sender names.
+    rdma_qp(rdma_context const &ctx, rdma_xrcd const &xrcd,
+            rdma_qp_config const &config = {})
+        : rdma_qp(ctx, nullptr, nullptr, nullptr, xrcd.get_xrcd(), config,
+                  no_features) {
+        static_assert(Type == IBV_QPT_XRC_RECV,
+                      "only XRC receive QPs belong to an XRC domain");
+    }
+
+protected:
+    template <uint32_t C, uint32_t F>
+    rdma_qp(rdma_context const &ctx, rdma_cq const *send_cq,
+            rdma_cq const *recv_cq, ibv_srq *srq, ibv_xrcd *xrcd,
+            rdma_qp_config const &config,
+            qp_feature_base<C, F> const &features)
+        : ctx(ctx),
+          send_cq(send_cq),
+          srq(srq),
+          config(config.clamp_to_device(ctx)) {
+        auto qp = create_rdma_qp(ctx, this->config, send_cq, recv_cq, srq,
+                                 xrcd, features);
         if (qp.has_value()) {
-            this->qp = qp.value();
-            spdlog::trace(
-                "created queue pair {:p}, type {}, depth {} for context {:p}",
-                reinterpret_cast<void *>(this->qp), qptype_to_string(Type),
-                qp_depth, reinterpret_cast<void const *>(ctx.get_context()));
+            this->qp = std::get<0>(qp.value());
+            this->sq_depth = std::get<1>(qp.value()).max_send_wr;
+            this->max_inline_data = std::get<1>(qp.value()).max_inline_data;
+            spdlog::trace("created queue pair {:p}, type {}, depth {}, max "
+                          "inline data {} for context {:p}",
+                          reinterpret_cast<void *>(this->qp),
+                          qptype_to_string(Type), this->config.depth,
+                          max_inline_data,
+                          reinterpret_cast<void const *>(ctx.get_context()));
         } else {
             spdlog::error(
                 "failed to create queue pair with type {}, depth {} for "
                 "context {:p}",
-                qptype_to_string(Type), qp_depth,
+                qptype_to_string(Type), this->config.depth,
                 reinterpret_cast<void const *>(ctx.get_context()));
             panic_with_errno();
         }
     }
 
-    rdma_qp(rdma_context const &ctx, rdma_cq const &send_cq,
-            rdma_cq const &recv_cq, int qp_depth = kQpDepth)
-        : rdma_qp(ctx, send_cq, recv_cq, qp_depth, no_features) {}
+    static rdma_qp_config depth_config(int qp_depth) {
+        rdma_qp_config config;
+        config.depth = qp_depth;
+        return config;
+    }
 
+public:
     rdma_qp(rdma_qp const &) = delete;
     rdma_qp &operator=(rdma_qp const &) = delete;
 
-    rdma_qp(rdma_qp &&other) noexcept : ctx(other.ctx), qp(other.qp) {
+    rdma_qp(rdma_qp &&other) noexcept
+        : ctx(other.ctx),
+          send_cq(other.send_cq),
+          srq(other.srq),
+          config(other.config),
+          qp(other.qp),
+          port(other.port),
+          psn(other.psn),
+          sq_depth(other.sq_depth),
+          max_inline_data(other.max_inline_data),
+          auto_inline(other.auto_inline),
+          sq_tracker(std::move(other.sq_tracker)),
+          burst(other.burst) {
         other.qp = nullptr;
+        other.burst = nullptr;
     }
 
     rdma_qp &operator=(rdma_qp &&other) & noexcept {
@@ -110,6 +214,11 @@ public:
     }
 
     ~rdma_qp() {
+        if (burst) {
+            ibv_exp_release_intf_params params = {};
+            ibv_exp_release_intf(ctx.get_context(), burst, &params);
+            burst = nullptr;
+        }
         if (qp) {
             spdlog::trace("destroying queue pair {:p}",
                           reinterpret_cast<void *>(qp));
@@ -120,38 +229,273 @@ public:
 
     ibv_qp *get_qp() const { return qp; }
 
+    //! \brief Gets the shared receive queue of the QP, or nullptr if it has a
+    //! private receive queue.
+    ibv_srq *get_srq() const { return srq; }
+
+    //! \brief Gets the configuration of the QP, clamped to the device limits.
+    rdma_qp_config const &get_config() const { return config; }
+
+    //! \brief Gets the maximum inline payload size negotiated with the device.
+    uint32_t get_max_inline_data() const { return max_inline_data; }
+
+    //! \brief Sets whether send verbs without an explicit inline mode are
+    //! inlined when their payload fits in the negotiated inline size.
+    rdma_qp<Type> &set_auto_inline(bool enable) {
+        auto_inline = enable;
+        return *this;
+    }
+
+    bool is_auto_inline() const { return auto_inline; }
+
+    //! \brief Enables automatic selective signaling on the send queue.
+    //!
+    //! At least every `interval`-th send work request is signaled, and posting
+    //! reaps the send CQ whenever the send queue is full instead of
+    //! overflowing it. Completions of verbs that are not notified never reach
+    //! the caller. An interval of 0 picks a quarter of the send queue depth.
+    //! Must be called before posting any send verb, and neither together
+    //! with the accelerated send path nor on a send CQ with burst polls.
+    rdma_qp<Type> &enable_auto_signal(uint32_t interval = 0) {
+        RDMALIB2_ASSERT(!sq_tracker);
+        // Accelerated sends would bypass the tracker
+        RDMALIB2_ASSERT(!burst);
+        // Posting reaps the send CQ, which must not have been moved away
+        RDMALIB2_ASSERT(send_cq && send_cq->get_cq());
+        send_cq->mark_tracked();
+        if (interval == 0) {
+            interval = std::max(sq_depth / 4, 1u);
+        }
+        sq_tracker = std::make_unique<rdma_sq_tracker>(sq_depth, interval);
+        return *this;
+    }
+
+    //! \brief Gets the send queue tracker, or nullptr if automatic selective
+    //! signaling is disabled.
+    rdma_sq_tracker const *get_sq_tracker() const { return sq_tracker.get(); }
+
+    //! \brief Enables the accelerated send path of `post_send()`, which
+    //! skips building work requests.
+    //!
+    //! Must be called once the QP is ready to send, and not together with
+    //! automatic selective signaling: accelerated sends carry no wr_id.
+    //!
+    //! \return Whether the device supports the interface. If not,
+    //! `post_send()` falls back to regular work requests.
+    bool enable_burst() {
+        RDMALIB2_ASSERT(!sq_tracker);
+        if (burst) {
+            return true;
+        }
+
+        ibv_exp_query_intf_params params = {};
+        params.intf_scope = IBV_EXP_INTF_GLOBAL;
+        params.intf = IBV_EXP_INTF_QP_BURST;
+        params.intf_version = 0;
+        params.obj = qp;
+
+        ibv_exp_query_intf_status status = IBV_EXP_INTF_STAT_OK;
+        auto *family = static_cast<ibv_exp_qp_burst_family *>(
+            ibv_exp_query_intf(ctx.get_context(), &params, &status));
+        if (!family || status != IBV_EXP_INTF_STAT_OK) {
+            spdlog::trace("accelerated interface unavailable for queue pair "
+                          "{:p}: status {}",
+                          reinterpret_cast<void *>(qp),
+                          static_cast<int>(status));
+            return false;
+        }
+        burst = family;
+        return true;
+    }
+
+    bool is_burst_enabled() const { return burst != nullptr; }
+
+    //! \brief Queues a send of `msg` without ringing the doorbell, which is
+    //! deferred to the next `flush_sends()`.
+    //!
+    //! Without the accelerated interface, the send is posted right away as a
+    //! regular work request with wr_id 0.
+    void post_send_pending(rdma_memory_slice const &msg,
+                           bool notify = false) const {
+        if (burst) {
+            uint32_t flags = notify ? IBV_EXP_QP_BURST_SIGNALED : 0;
+            int ret = 0;
+            if (auto_inline && msg.get_size() <= max_inline_data) {
+                ret = burst->send_pending_inline(qp, msg.get_ptr(),
+                                                 msg.get_size(), flags);
+            } else {
+                ret = burst->send_pending(
+                    qp, reinterpret_cast<uint64_t>(msg.get_ptr()),
+                    msg.get_size(), msg.get_lkey(), flags);
+            }
+            if (unlikely(ret)) {
+                spdlog::error("queue send failed with return value {}", ret);
+                panic_with_errno();
+            }
+            return;
+        }
+
+        ibv_sge sge = msg.to_sge();
+        ibv_exp_send_wr wr = {};
+        wr.sg_list = &sge;
+        wr.num_sge = 1;
+        wr.exp_opcode = IBV_EXP_WR_SEND;
+        if (auto_inline && msg.get_size() <= max_inline_data) {
+            wr.exp_send_flags |= IBV_EXP_SEND_INLINE;
+        }
+        if (sq_tracker) {
+            wait_for_sq(1);
+        }
+        apply_signaling(0, notify, wr);
+
+        ibv_exp_send_wr *bad_wr = nullptr;
+        int ret = ibv_exp_post_send(qp, &wr, &bad_wr);
+        if (unlikely(ret)) {
+            spdlog::error("post send failed with return value {}", ret);
+            panic_with_errno();
+        }
+    }
+
+    //! \brief Rings the doorbell for all sends queued by
+    //! `post_send_pending()`.
+    void flush_sends() const {
+        if (burst) {
+            int ret = burst->send_flush(qp);
+            if (unlikely(ret)) {
+                spdlog::error("flush sends failed with return value {}", ret);
+                panic_with_errno();
+            }
+        }
+    }
+
+    //! \brief Sends `msg` right away, through the accelerated interface if
+    //! enabled.
+    void post_send(rdma_memory_slice const &msg, bool notify = false) const {
+        post_send_pending(msg, notify);
+        flush_sends();
+    }
+
     rdma_qp<Type> &bind_port(uint8_t port = 1) {
         this->port = port;
         if constexpr (Type == IBV_QPT_UD || Type == IBV_QPT_RAW_PACKET) {
-            static constexpr uint32_t ud_qkey = 0x11111111;
+            modify_qp_to_init(qp, port, kUdQkey);
+            modify_qp_to_rtr(qp, config, {}, 0, 0, universal_init_psn, port);
+            modify_qp_to_rts(qp, config, universal_init_psn);
+        } else if constexpr (Type == IBV_EXP_QPT_DC_INI) {
+            config = config.clamp_to_port(ctx, port);
+            modify_dci_to_rts(qp, config, port);
+        }
+        return *this;
+    }
+
+    //! \brief Brings a DC initiator that hit a transport error back to RTS.
+    //!
+    //! A DCI is not tied to any target, so unlike an RC QP it can resume
+    //! sending on its own once reset.
+    //!
+    //! \return Whether the DCI was in an error state.
+    bool recover() {
+        static_assert(Type == IBV_EXP_QPT_DC_INI,
+                      "only DC initiators recover without the remote side");
 
-            modify_qp_to_init(qp, port, ud_qkey);
-            modify_qp_to_rtr(qp, {}, 0, 0, universal_init_psn, port);
-            modify_qp_to_rts(qp, universal_init_psn);
+        ibv_qp_attr attr = {};
+        ibv_qp_init_attr init_attr = {};
+        if (ibv_query_qp(qp, &attr, IBV_QP_STATE, &init_attr)) {
+            spdlog::error("failed to query state of QP {:p}",
+                          reinterpret_cast<void *>(qp));
+            panic_with_errno();
+        }
+        if (attr.qp_state != IBV_QPS_ERR && attr.qp_state != IBV_QPS_SQE) {
+            return false;
+        }
+
+        spdlog::warn("recovering DC initiator {:p} from state {}",
+                     reinterpret_cast<void *>(qp),
+                     static_cast<int>(attr.qp_state));
+        reset();
+        modify_dci_to_rts(qp, config, port);
+        return true;
+    }
+
+    //! \brief Moves the QP back to RESET, discarding its outstanding work
+    //! requests, so that it can be connected again without re-creating it.
+    //!
+    //! Completions of earlier work requests must have been polled already.
+    rdma_qp<Type> &reset() {
+        modify_qp_to_reset(qp);
+        if (sq_tracker) {
+            sq_tracker->clear();
         }
         return *this;
     }
 
+    //! \brief Resets the QP and connects it to another remote QP, which only
+    //! costs the state transitions. The remote QP connects with what
+    //! `get_info()` reports before the call.
+    rdma_qp<Type> &reconnect(info const &remote, uint8_t port = 1) {
+        return reset().connect(remote, port);
+    }
+
+    //! \brief Connects an RC QP to a remote RC QP, or an XRC send QP to a
+    //! remote XRC receive QP and vice versa.
+    //!
+    //! The QP sends from the PSN that `get_info()` reported, then draws a
+    //! fresh one for the next connection, so that packets of an old
+    //! connection still in the network never match the PSNs of a new one.
     rdma_qp<Type> &connect(info const &remote, uint8_t port = 1) {
-        RDMALIB2_ASSERT(qp->qp_type == IBV_QPT_RC);
+        RDMALIB2_ASSERT(qp->qp_type == IBV_QPT_RC ||
+                        qp->qp_type == IBV_QPT_XRC_SEND ||
+                        qp->qp_type == IBV_QPT_XRC_RECV);
 
+        config = config.clamp_to_port(ctx, port);
         modify_qp_to_init(qp, port);
-        modify_qp_to_rtr(qp, remote.gid, remote.lid, remote.qp_num, remote.psn,
-                         port);
-        modify_qp_to_rts(qp, universal_init_psn);
+        modify_qp_to_rtr(qp, config, remote.gid, remote.lid, remote.qp_num,
+                         remote.psn, port);
+        // XRC receive QPs never send, so they stop at RTR
+        if constexpr (Type != IBV_QPT_XRC_RECV) {
+            modify_qp_to_rts(qp, config, psn);
+        }
+        psn = random_psn();
         return *this;
     }
 
-    info get_qp_info() const {
-        return {ctx.get_gid(port), ctx.get_port_lid(port), qp->qp_num,
-                universal_init_psn};
-    }
+    info get_qp_info() const { return get_info(); }
 
-    template <typename Wr> void post_verb(rdma_verb<Wr> &) const;
+    template <typename Tag, uint32_t MaxSge>
+    void post_verb(rdma_verb<Tag, MaxSge> &) const;
 
     template <typename ForwardIt>
     void post_verb(ForwardIt first, ForwardIt last) const;
 
+    template <size_t N, uint32_t MaxSge>
+    void post_verb(rdma_verb_batch<N, MaxSge> &) const;
+
+protected:
+    //! \brief Reaps the send CQ until `n` send queue slots are free.
+    void wait_for_sq(uint32_t n) const {
+        RDMALIB2_ASSERT(n <= sq_tracker->get_max_post());
+        while (unlikely(sq_tracker->get_available() < n)) {
+            send_cq->reap();
+        }
+    }
+
+    //! \brief Sets the wr_id and signaling flag of a send work request about
+    //! to be posted, consulting the send queue tracker if there is one.
+    void apply_signaling(uint64_t wr_id, bool notified,
+                         ibv_exp_send_wr &wr) const {
+        RDMALIB2_ASSERT(!(wr_id & rdma_sq_tracker::wr_id_tag));
+        std::optional<uint64_t> signal_id =
+            sq_tracker ? sq_tracker->track(wr_id, notified)
+                       : (notified ? std::make_optional(wr_id) : std::nullopt);
+        if (signal_id.has_value()) {
+            wr.wr_id = signal_id.value();
+            wr.exp_send_flags |= IBV_EXP_SEND_SIGNALED;
+        } else {
+            wr.wr_id = wr_id;
+            wr.exp_send_flags &= ~IBV_EXP_SEND_SIGNALED;
+        }
+    }
+
 public:
     static constexpr qp_feature_base<0, 0> no_features = {};
     static constexpr qp_feature_base<IBV_EXP_QP_INIT_ATTR_ATOMICS_ARG, 0>
@@ -162,28 +506,45 @@ public:
 
 protected:
     template <uint32_t CompMask, uint32_t CreateFlags>
-    static std::optional<ibv_qp *>
-    create_rdma_qp(rdma_context const &ctx, int qp_depth,
-                   rdma_cq const &send_cq, rdma_cq const &recv_cq,
+    static std::optional<std::tuple<ibv_qp *, ibv_qp_cap>>
+    create_rdma_qp(rdma_context const &ctx, rdma_qp_config const &config,
+                   rdma_cq const *send_cq, rdma_cq const *recv_cq,
+                   ibv_srq *srq, ibv_xrcd *xrcd,
                    qp_feature_base<CompMask, CreateFlags> const &features) {
         ibv_exp_qp_init_attr init_attr = {};
-        init_attr.send_cq = send_cq.get_cq();
-        init_attr.recv_cq = recv_cq.get_cq();
-        init_attr.cap.max_send_wr = qp_depth;
-        init_attr.cap.max_recv_wr = qp_depth;
-        init_attr.cap.max_send_sge = kMaxSge;
-        init_attr.cap.max_recv_sge = kMaxSge;
-        init_attr.cap.max_inline_data = kMaxInlineData;
+        init_attr.send_cq = send_cq ? send_cq->get_cq() : nullptr;
+        init_attr.recv_cq = recv_cq ? recv_cq->get_cq() : nullptr;
+        init_attr.cap.max_send_wr = config.depth;
+        init_attr.cap.max_recv_wr = config.depth;
+        init_attr.cap.max_send_sge = config.max_sge;
+        init_attr.cap.max_recv_sge = config.max_sge;
+        init_attr.cap.max_inline_data = config.max_inline_data;
         init_attr.qp_type = Type;
         init_attr.comp_mask = IBV_EXP_QP_INIT_ATTR_PD;
         init_attr.pd = ctx.get_pd();
 
+        // Receive work requests come from the SRQ instead, and XRC send QPs
+        // and DC initiators only ever send
+        if (srq || Type == IBV_QPT_XRC_SEND || Type == IBV_EXP_QPT_DC_INI) {
+            init_attr.srq = srq;
+            init_attr.cap.max_recv_wr = 0;
+            init_attr.cap.max_recv_sge = 0;
+        }
+
         auto rd = ctx.get_res_domain();
         if (rd.has_value()) {
             init_attr.comp_mask |= IBV_EXP_QP_INIT_ATTR_RES_DOMAIN;
             init_attr.res_domain = rd.value();
         }
 
+        // XRC receive QPs belong to the domain, and have no queues
+        if constexpr (Type == IBV_QPT_XRC_RECV) {
+            init_attr.comp_mask = IBV_EXP_QP_INIT_ATTR_XRCD;
+            init_attr.xrcd = xrcd;
+            init_attr.pd = nullptr;
+            init_attr.cap = {};
+        }
+
         // Extended atomics feature
         if constexpr (CompMask & extended_atomics.comp_mask) {
             static_assert(Type == IBV_QPT_RC,
@@ -200,8 +561,20 @@ protected:
             init_attr.exp_create_flags |= erasure_coding.create_flags;
         }
 
+        // The provider writes back the actually granted capabilities
         ibv_qp *qp = ibv_exp_create_qp(ctx.get_context(), &init_attr);
-        return qp ? std::make_optional(qp) : std::nullopt;
+        return qp ? std::make_optional(std::make_tuple(qp, init_attr.cap))
+                  : std::nullopt;
+    }
+
+    static void modify_qp_to_reset(ibv_qp *qp) {
+        ibv_qp_attr attr = {};
+        attr.qp_state = IBV_QPS_RESET;
+        if (ibv_modify_qp(qp, &attr, IBV_QP_STATE)) {
+            spdlog::error("failed to modify QP {:p} to RESET state",
+                          reinterpret_cast<void *>(qp));
+            panic_with_errno();
+        }
     }
 
     static void modify_qp_to_init(ibv_qp *qp, uint8_t port_num = 1,
@@ -215,7 +588,8 @@ protected:
 
         int flags = IBV_QP_STATE | IBV_QP_PKEY_INDEX | IBV_QP_PORT;
 
-        if constexpr (Type == IBV_QPT_RC) {
+        if constexpr (Type == IBV_QPT_RC || Type == IBV_QPT_XRC_SEND ||
+                      Type == IBV_QPT_XRC_RECV) {
             attr.qp_access_flags = IBV_ACCESS_REMOTE_READ |
                                    IBV_ACCESS_REMOTE_WRITE |
                                    IBV_ACCESS_REMOTE_ATOMIC;
@@ -240,14 +614,15 @@ protected:
         }
     } // namespace rdmalib2
 
-    static void modify_qp_to_rtr(ibv_qp *qp, ibv_gid remote_gid,
-                                 uint32_t remote_lid, uint32_t remote_qpn,
-                                 uint32_t psn, uint32_t port = 1) {
+    static void modify_qp_to_rtr(ibv_qp *qp, rdma_qp_config const &config,
+                                 ibv_gid remote_gid, uint32_t remote_lid,
+                                 uint32_t remote_qpn, uint32_t psn,
+                                 uint32_t port = 1) {
         RDMALIB2_ASSERT(qp->state == IBV_QPS_INIT);
 
         ibv_qp_attr attr = {};
         attr.qp_state = IBV_QPS_RTR;
-        attr.path_mtu = IBV_MTU_4096;
+        attr.path_mtu = config.path_mtu;
         attr.dest_qp_num = remote_qpn;
         attr.rq_psn = psn;
 
@@ -266,9 +641,9 @@ protected:
         int flags = IBV_QP_STATE | IBV_QP_AV | IBV_QP_PATH_MTU |
                     IBV_QP_DEST_QPN | IBV_QP_RQ_PSN;
 
-        if constexpr (Type == IBV_QPT_RC) {
-            attr.max_dest_rd_atomic = 16;
-            attr.min_rnr_timer = 12;
+        if constexpr (Type == IBV_QPT_RC || Type == IBV_QPT_XRC_RECV) {
+            attr.max_dest_rd_atomic = config.max_dest_rd_atomic;
+            attr.min_rnr_timer = config.min_rnr_timer;
             flags |= IBV_QP_MAX_DEST_RD_ATOMIC | IBV_QP_MIN_RNR_TIMER;
         } else if constexpr (Type == IBV_QPT_UD || Type == IBV_QPT_RAW_PACKET) {
             flags = IBV_QP_STATE;
@@ -282,7 +657,8 @@ protected:
         }
     }
 
-    static void modify_qp_to_rts(ibv_qp *qp, uint32_t psn) {
+    static void modify_qp_to_rts(ibv_qp *qp, rdma_qp_config const &config,
+                                 uint32_t psn) {
         RDMALIB2_ASSERT(qp->state == IBV_QPS_RTR);
 
         ibv_qp_attr attr = {};
@@ -291,11 +667,11 @@ protected:
 
         int flags = IBV_QP_STATE | IBV_QP_SQ_PSN;
 
-        if constexpr (Type == IBV_QPT_RC) {
-            attr.timeout = 14;
-            attr.retry_cnt = 7;
-            attr.rnr_retry = 6;
-            attr.max_rd_atomic = 16;
+        if constexpr (Type == IBV_QPT_RC || Type == IBV_QPT_XRC_SEND) {
+            attr.timeout = config.timeout;
+            attr.retry_cnt = config.retry_cnt;
+            attr.rnr_retry = config.rnr_retry;
+            attr.max_rd_atomic = config.max_rd_atomic;
             flags |= IBV_QP_TIMEOUT | IBV_QP_RETRY_CNT | IBV_QP_RNR_RETRY |
                      IBV_QP_MAX_QP_RD_ATOMIC;
         } else if constexpr (Type == IBV_QPT_RAW_PACKET) {
@@ -310,11 +686,79 @@ protected:
         }
     }
 
+    //! \brief Brings a DC initiator from RESET to RTS. Its destination is
+    //! given by every work request, so only the local port is needed.
+    static void modify_dci_to_rts(ibv_qp *qp, rdma_qp_config const &config,
+                                  uint8_t port) {
+        ibv_exp_qp_attr attr = {};
+        attr.qp_state = IBV_QPS_INIT;
+        attr.pkey_index = 0;
+        attr.port_num = port;
+        attr.dct_key = kDcKey;
+        if (ibv_exp_modify_qp(qp, &attr,
+                              IBV_EXP_QP_STATE | IBV_EXP_QP_PKEY_INDEX |
+                                  IBV_EXP_QP_PORT | IBV_EXP_QP_DC_KEY)) {
+            spdlog::error("failed to modify DCI {:p} to INIT state",
+                          reinterpret_cast<void *>(qp));
+            panic_with_errno();
+        }
+
+        attr = {};
+        attr.qp_state = IBV_QPS_RTR;
+        attr.path_mtu = config.path_mtu;
+        attr.ah_attr.port_num = port;
+        attr.ah_attr.is_global = 1;
+        attr.ah_attr.grh.hop_limit = 0xFF;
+        attr.ah_attr.grh.sgid_index = rdma_context::universal_gid_index;
+        if (ibv_exp_modify_qp(qp, &attr,
+                              IBV_EXP_QP_STATE | IBV_EXP_QP_PATH_MTU |
+                                  IBV_EXP_QP_AV)) {
+            spdlog::error("failed to modify DCI {:p} to RTR state",
+                          reinterpret_cast<void *>(qp));
+            panic_with_errno();
+        }
+
+        // The device retries and reconnects to targets on its own, within
+        // the configured budgets
+        attr = {};
+        attr.qp_state = IBV_QPS_RTS;
+        attr.timeout = config.timeout;
+        attr.retry_cnt = config.retry_cnt;
+        attr.rnr_retry = config.rnr_retry;
+        attr.max_rd_atomic = config.max_rd_atomic;
+        if (ibv_exp_modify_qp(qp, &attr,
+                              IBV_EXP_QP_STATE | IBV_EXP_QP_TIMEOUT |
+                                  IBV_EXP_QP_RETRY_CNT | IBV_EXP_QP_RNR_RETRY |
+                                  IBV_EXP_QP_MAX_QP_RD_ATOMIC)) {
+            spdlog::error("failed to modify DCI {:p} to RTS state",
+                          reinterpret_cast<void *>(qp));
+            panic_with_errno();
+        }
+    }
+
     rdma_context const &ctx;
+    rdma_cq const *send_cq = nullptr;
+    ibv_srq *srq = nullptr;
+    rdma_qp_config config;
     ibv_qp *qp = nullptr;
     uint8_t port = 1;
+    // Initial PSN of the next connection
+    uint32_t psn = random_psn();
+    uint32_t sq_depth = 0;
+    uint32_t max_inline_data = 0;
+    bool auto_inline = true;
+    std::unique_ptr<rdma_sq_tracker> sq_tracker;
+
+    // Accelerated send interface, if enabled
+    ibv_exp_qp_burst_family *burst = nullptr;
 
     static constexpr uint32_t universal_init_psn = 3000;
+
+    static uint32_t random_psn() {
+        thread_local std::mt19937 gen{std::random_device{}()};
+        // PSNs are 24 bits wide
+        return gen() & 0xFFFFFF;
+    }
 }; // namespace rdmalib2
 
 typedef rdma_qp<IBV_QPT_RAW_PACKET> rdma_raw_packet_qp;
@@ -5,13 +5,16 @@
 
 #include "../context.h"
 #include "../mem.h"
+#include <algorithm>
+#include <memory>
 #include <new>
 #include <optional>
 
 namespace rdmalib2 {
 
-// Predeclaration of rdma_qp class
+// Predeclaration of rdma_qp and rdma_srq classes
 template <ibv_qp_type Type> class rdma_qp;
+class rdma_srq;
 
 template <ibv_exp_wr_opcode Opcode> struct wr_type_base {
     static constexpr ibv_exp_wr_opcode opcode = Opcode;
@@ -29,34 +32,75 @@ static constexpr wr_type_base<IBV_EXP_WR_EXT_MASKED_ATOMIC_CMP_AND_SWP>
 static constexpr wr_type_base<IBV_EXP_WR_EXT_MASKED_ATOMIC_FETCH_AND_ADD>
     op_masked_faa = {};
 
-template <typename Wr> class rdma_verb {
+//! \brief The destination of a UD send.
+struct rdma_ud_dest {
+    ibv_ah *ah;
+    uint32_t remote_qpn;
+    uint32_t remote_qkey = kUdQkey;
+    //! Keeps an address handle from `rdma_ah_cache` alive while held
+    std::shared_ptr<ibv_ah> pin = nullptr;
+};
+
+//! \brief The destination of a verb posted to a DC initiator: the address of
+//! the target node and its DC target number.
+struct rdma_dc_dest {
+    ibv_ah *ah;
+    uint32_t dct_number;
+    uint64_t dc_key = kDcKey;
+    //! Keeps an address handle from `rdma_ah_cache` alive while held
+    std::shared_ptr<ibv_ah> pin = nullptr;
+};
+
+//! \brief An RDMA verb with an inline scatter-gather list of at most `MaxSge`
+//! entries.
+//!
+//! The scatter-gather list is stored as raw `ibv_sge` entries inside the verb
+//! object, so building, copying and re-slicing a verb never allocates.
+template <typename Wr, uint32_t MaxSge = kMaxSge> class rdma_verb {
+    static_assert(MaxSge > 0, "scatter-gather list capacity must be positive");
+    static_assert(MaxSge <= kMaxSge,
+                  "scatter-gather list capacity exceeds QP limit kMaxSge");
+
 public:
     // Expose work request type for public use
     using wr_type = Wr;
+    static constexpr uint32_t max_sge = MaxSge;
+    static constexpr bool is_typed = false;
 
 public:
     rdma_verb() = default;
 
-    template <typename... MemSlices> rdma_verb(MemSlices... sgl_entries) {
-        set_sgl_entry(std::forward<MemSlices...>(sgl_entries...));
+    template <typename... MemSlices>
+    rdma_verb(rdma_memory_slice const &head, MemSlices const &...tail) {
+        set_sgl_entry(head, tail...);
     }
 
     rdma_verb(rdma_verb const &other)
-        : sgl(other.sgl), notified(other.notified) {}
+        : num_sge(other.num_sge),
+          length(other.length),
+          has_unregistered(other.has_unregistered),
+          notified(other.notified),
+          inlined(other.inlined) {
+        std::copy_n(other.sgl, other.num_sge, sgl);
+    }
 
-    rdma_verb(rdma_verb &&other) noexcept
-        : sgl(std::move(other.sgl)), notified(std::move(other.notified)) {}
+    rdma_verb(rdma_verb &&other) noexcept : rdma_verb(other) {}
 
     rdma_verb &operator=(rdma_verb const &other) & {
-        sgl = other.sgl;
-        notified = other.notified;
+        if (this != &other) {
+            std::copy_n(other.sgl, other.num_sge, sgl);
+            num_sge = other.num_sge;
+            length = other.length;
+            has_unregistered = other.has_unregistered;
+            notified = other.notified;
+            inlined = other.inlined;
+            constructed_wr = false;
+        }
         return *this;
     }
 
     rdma_verb &operator=(rdma_verb &&other) & noexcept {
-        sgl = std::move(other.sgl);
-        notified = std::move(other.notified);
-        return *this;
+        return *this = other;
     }
 
     ~rdma_verb() = default;
@@ -71,42 +115,67 @@ public:
             }
         }
         construct_wr();
+        if constexpr (std::is_same_v<Wr, ibv_exp_send_wr>) {
+            // Checked at post time, as the setters may pass through an
+            // empty scatter-gather list while re-slicing a verb
+            if (is_atomic_opcode()) {
+                RDMALIB2_ASSERT(is_atomic_capable());
+            }
+        }
         wr.next = nullptr;
         return wr;
     }
 
+    //! \brief Constructs, caches, and gets the work request with the inline
+    //! flag resolved against a QP's inline policy.
+    //!
+    //! An explicit per-verb inline mode takes precedence; otherwise the verb is
+    //! inlined iff `auto_inline` is set, its opcode carries a local payload, and
+    //! its total message length fits in `max_inline_data`.
+    Wr const &get_wr(bool auto_inline, uint32_t max_inline_data) {
+        get_wr();
+        if constexpr (std::is_same_v<Wr, ibv_exp_send_wr>) {
+            if (resolve_inline(auto_inline, max_inline_data)) {
+                wr.exp_send_flags |= IBV_EXP_SEND_INLINE;
+            } else {
+                wr.exp_send_flags &= ~IBV_EXP_SEND_INLINE;
+            }
+        }
+        return wr;
+    }
+
     //! \brief Temporarily sets the next work request in the chain.
     //! The next work request pointer will be reset after the next call to
     //! get_wr().
-    rdma_verb<Wr> &set_next(rdma_verb const &next) {
+    rdma_verb &set_next(rdma_verb &next) {
         wr.next = const_cast<Wr *>(&next.get_wr());
         return *this;
     }
 
     //! \brief Clears the next work request pointer.
-    rdma_verb<Wr> &clear_next() {
+    rdma_verb &clear_next() {
         wr.next = nullptr;
         return *this;
     }
 
     //! \brief Sets the work request ID.
-    rdma_verb<Wr> &set_id(uint64_t id) {
-        if (wr_id != id) {
-            wr_id = id;
-            constructed_wr = false;
+    rdma_verb &set_id(uint64_t id) {
+        wr_id = id;
+        if (constructed_wr) {
+            wr.wr_id = id;
         }
         return *this;
     }
 
+    //! \brief Gets the work request ID.
+    uint64_t get_id() const { return wr_id; }
+
     //! \brief Sets the opcode.
     template <ibv_exp_wr_opcode Opcode>
-    rdma_verb<Wr> &set_op(wr_type_base<Opcode> const &op) {
+    rdma_verb &set_op(wr_type_base<Opcode> const &op) {
         static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
                       "cannot set opcode for recv verb");
-        if (opcode != Opcode) {
-            opcode = Opcode;
-            constructed_wr = false;
-        }
+        set_opcode(Opcode);
         return *this;
     }
 
@@ -122,36 +191,65 @@ public:
     //! Each parameter accounts for a scatter-gather list entry.
     //! The original scatter-gather list will be cleared.
     template <typename... MemSlice>
-    rdma_verb<Wr> &set_sgl_entry(MemSlice... slices) {
-        sgl.clear();
+    rdma_verb &set_sgl_entry(MemSlice const &...slices) {
+        clear_sgl();
+        return add_sgl_entry(slices...);
+    }
+
+    //! \brief Clears the scatter-gather list.
+    rdma_verb &clear_sgl() {
+        num_sge = 0;
         length = 0;
-        constructed_real_sgl = false;
-        return add_sgl_entry(std::forward<MemSlice...>(slices...));
+        has_unregistered = false;
+        patch_sgl();
+        return *this;
     }
 
     //! \brief Appends entries to the scatter-gather list.
     template <typename... MemSlice>
-    rdma_verb<Wr> &add_sgl_entry(rdma_memory_slice const &head,
-                                 MemSlice... tail) {
+    rdma_verb &add_sgl_entry(rdma_memory_slice const &head,
+                             MemSlice const &...tail) {
         // reject long sg-lists at compile time
-        static_assert(1 + sizeof...(tail) <= kMaxSge,
+        static_assert(1 + sizeof...(tail) <= MaxSge,
                       "too many scatter-gather list entries");
         // then, we can only prevent long sg-lists at runtime
-        RDMALIB2_ASSERT(sgl.size() < kMaxSge);
+        RDMALIB2_ASSERT(num_sge < MaxSge);
 
-        sgl.emplace_back(head);
+        sgl[num_sge++] = head.to_sge();
         length += head.get_size();
-        constructed_real_sgl = false;
         if constexpr (sizeof...(tail) == 0) {
+            patch_sgl();
             return *this;
         } else {
-            return add_sgl_entry(std::forward<MemSlice...>(tail...));
+            return add_sgl_entry(tail...);
         }
     }
 
+    //! \brief Appends an entry pointing to memory that is not registered.
+    //!
+    //! The payload is copied into the work queue entry at post time, so the
+    //! verb is always posted inline and the buffer can be reused as soon as
+    //! the post returns.
+    rdma_verb &add_unregistered_entry(void const *buf, size_t size) {
+        static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
+                      "cannot receive into unregistered memory");
+        RDMALIB2_ASSERT(num_sge < MaxSge);
+
+        sgl[num_sge++] = {.addr = reinterpret_cast<uint64_t>(buf),
+                          .length = static_cast<uint32_t>(size),
+                          .lkey = 0};
+        length += size;
+        has_unregistered = true;
+        patch_sgl();
+        return *this;
+    }
+
+    //! \brief Gets the number of scatter-gather list entries.
+    uint32_t get_num_sge() const { return num_sge; }
+
     size_t get_total_msg_length() const { return length; }
 
-    rdma_verb<Wr> &set_remote_memory(rdma_remote_memory_slice const &remote) {
+    rdma_verb &set_remote_memory(rdma_remote_memory_slice const &remote) {
         static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
                       "cannot set remote memory for recv verb");
         if (unlikely(opcode == IBV_EXP_WR_SEND ||
@@ -163,23 +261,63 @@ public:
                 remote.get_size(), length);
         }
         this->remote = remote;
-        constructed_wr = false;
+        if (constructed_wr) {
+            patch_remote();
+        }
+        return *this;
+    }
+
+    //! \brief Sets the destination of a send verb posted to a UD QP.
+    rdma_verb &set_ud_dest(rdma_ud_dest const &dest) {
+        static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
+                      "cannot set UD destination for recv verb");
+        ud_dest = dest;
+        if (constructed_wr) {
+            patch_remote();
+        }
+        return *this;
+    }
+
+    //! \brief Sets the destination of a verb posted to a DC initiator.
+    rdma_verb &set_dc_dest(rdma_dc_dest const &dest) {
+        static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
+                      "cannot set DC destination for recv verb");
+        dc_dest = dest;
+        if (constructed_wr) {
+            patch_remote();
+        }
         return *this;
     }
 
-    rdma_verb<Wr> &set_notify(bool notify) {
+    //! \brief Sets the number of the remote XRC SRQ that a verb posted to
+    //! an XRC send QP is delivered to.
+    rdma_verb &set_remote_srq(uint32_t srq_num) {
+        static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
+                      "cannot set remote SRQ for recv verb");
+        remote_srq = srq_num;
+        if (constructed_wr) {
+            patch_remote();
+        }
+        return *this;
+    }
+
+    rdma_verb &set_notify(bool notify) {
         static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
                       "cannot set notify for recv verb");
-        if (notified != notify) {
-            notified = notify;
-            constructed_wr = false;
+        notified = notify;
+        if (constructed_wr) {
+            if (notify) {
+                wr.exp_send_flags |= IBV_EXP_SEND_SIGNALED;
+            } else {
+                wr.exp_send_flags &= ~IBV_EXP_SEND_SIGNALED;
+            }
         }
         return *this;
     }
 
-    rdma_verb<Wr> &set_notified() { return set_notify(true); }
+    rdma_verb &set_notified() { return set_notify(true); }
 
-    rdma_verb<Wr> &set_unnotified() { return set_notify(false); }
+    rdma_verb &set_unnotified() { return set_notify(false); }
 
     bool is_notified() const {
         if constexpr (std::is_same_v<Wr, ibv_exp_send_wr>) {
@@ -188,7 +326,30 @@ public:
         return true;
     }
 
-    rdma_verb<Wr> &set_imm(uint32_t imm_data) {
+    //! \brief Forces inlining on or off for this verb, overriding the QP's
+    //! inline policy.
+    rdma_verb &set_inline(bool inline_data) {
+        static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
+                      "cannot set inline for recv verb");
+        inlined = inline_data;
+        return *this;
+    }
+
+    rdma_verb &set_inlined() { return set_inline(true); }
+
+    rdma_verb &set_uninlined() { return set_inline(false); }
+
+    //! \brief Lets the QP's inline policy decide whether to inline this verb.
+    rdma_verb &clear_inline() {
+        static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
+                      "cannot clear inline for recv verb");
+        inlined = std::nullopt;
+        return *this;
+    }
+
+    std::optional<bool> get_inline() const { return inlined; }
+
+    rdma_verb &set_imm(uint32_t imm_data) {
         static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
                       "cannot set immediate data for recv verb");
         if (unlikely(opcode.has_value() && opcode != IBV_EXP_WR_SEND_WITH_IMM &&
@@ -198,49 +359,55 @@ public:
         }
         this->carry_imm = true;
         this->imm_data = imm_data;
-        constructed_wr = false;
+        if (constructed_wr) {
+            wr.ex.imm_data = imm_data;
+        }
         return *this;
     }
 
-    rdma_verb<Wr> &clear_imm() {
+    rdma_verb &clear_imm() {
         static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
                       "cannot clear immediate data for recv verb");
-        if (this->carry_imm) {
-            this->carry_imm = false;
-            constructed_wr = false;
+        this->carry_imm = false;
+        if (constructed_wr) {
+            wr.ex.imm_data = 0;
         }
         return *this;
     }
 
-    rdma_verb<Wr> &set_cas(uint64_t compare, uint64_t swap) {
+    rdma_verb &set_cas(uint64_t compare, uint64_t swap) {
         static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
                       "cannot set CAS for recv verb");
         if (unlikely(opcode.has_value() &&
                      opcode != IBV_EXP_WR_ATOMIC_CMP_AND_SWP)) {
             spdlog::warn("setting CAS overwrites opcode for non-CAS verb");
         }
-        opcode = IBV_EXP_WR_ATOMIC_CMP_AND_SWP;
+        set_opcode(IBV_EXP_WR_ATOMIC_CMP_AND_SWP);
         this->compare_add = compare;
         this->swap = swap;
-        constructed_wr = false;
+        if (constructed_wr) {
+            patch_args();
+        }
         return *this;
     }
 
-    rdma_verb<Wr> &set_faa(uint64_t add) {
+    rdma_verb &set_faa(uint64_t add) {
         static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
                       "cannot set FAA for recv verb");
         if (unlikely(opcode.has_value() &&
                      opcode != IBV_EXP_WR_ATOMIC_FETCH_AND_ADD)) {
             spdlog::warn("setting FAA overwrites opcode for non-FAA verb");
         }
-        opcode = IBV_EXP_WR_ATOMIC_FETCH_AND_ADD;
+        set_opcode(IBV_EXP_WR_ATOMIC_FETCH_AND_ADD);
         this->compare_add = add;
-        constructed_wr = false;
+        if (constructed_wr) {
+            patch_args();
+        }
         return *this;
     }
 
-    rdma_verb<Wr> &set_masked_cas(uint64_t compare, uint64_t swap,
-                                  uint64_t compare_mask, uint64_t swap_mask) {
+    rdma_verb &set_masked_cas(uint64_t compare, uint64_t swap,
+                              uint64_t compare_mask, uint64_t swap_mask) {
         static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
                       "cannot set masked-CAS for recv verb");
         if (unlikely(opcode.has_value() &&
@@ -248,16 +415,18 @@ public:
             spdlog::warn(
                 "setting masked-CAS overwrites opcode for non-masked-CAS verb");
         }
-        opcode = IBV_EXP_WR_EXT_MASKED_ATOMIC_CMP_AND_SWP;
+        set_opcode(IBV_EXP_WR_EXT_MASKED_ATOMIC_CMP_AND_SWP);
         this->compare_add = compare;
         this->swap = swap;
         this->compare_add_mask = compare_mask;
         this->swap_mask = swap_mask;
-        constructed_wr = false;
+        if (constructed_wr) {
+            patch_args();
+        }
         return *this;
     }
 
-    rdma_verb<Wr> &set_masked_faa(uint64_t add, uint64_t add_mask) {
+    rdma_verb &set_masked_faa(uint64_t add, uint64_t add_mask) {
         static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
                       "cannot set masked-FAA for recv verb");
         if (unlikely(opcode.has_value() &&
@@ -265,14 +434,16 @@ public:
             spdlog::warn(
                 "setting masked-FAA overwrites opcode for non-masked-FAA verb");
         }
-        opcode = IBV_EXP_WR_EXT_MASKED_ATOMIC_FETCH_AND_ADD;
+        set_opcode(IBV_EXP_WR_EXT_MASKED_ATOMIC_FETCH_AND_ADD);
         this->compare_add = add;
         this->compare_add_mask = add_mask;
-        constructed_wr = false;
+        if (constructed_wr) {
+            patch_args();
+        }
         return *this;
     }
 
-    rdma_verb<Wr> &set_compare(uint64_t compare) {
+    rdma_verb &set_compare(uint64_t compare) {
         static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
                       "cannot set CAS.compare for recv verb");
         if (unlikely(opcode.has_value() &&
@@ -281,11 +452,13 @@ public:
             spdlog::warn("setting CAS.compare for non-CAS verb");
         }
         this->compare_add = compare;
-        constructed_wr = false;
+        if (constructed_wr) {
+            patch_args();
+        }
         return *this;
     }
 
-    rdma_verb<Wr> &set_swap(uint64_t swap) {
+    rdma_verb &set_swap(uint64_t swap) {
         static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
                       "cannot set CAS.swap for recv verb");
         if (unlikely(opcode.has_value() &&
@@ -294,11 +467,13 @@ public:
             spdlog::warn("setting CAS.swap for non-CAS verb");
         }
         this->swap = swap;
-        constructed_wr = false;
+        if (constructed_wr) {
+            patch_args();
+        }
         return *this;
     }
 
-    rdma_verb<Wr> &set_compare_mask(uint64_t compare_mask) {
+    rdma_verb &set_compare_mask(uint64_t compare_mask) {
         static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
                       "cannot set masked-CAS.compare_mask for recv verb");
         if (unlikely(opcode.has_value() &&
@@ -307,11 +482,13 @@ public:
                 "setting masked-CAS.compare_mask for non-masked-CAS verb");
         }
         this->compare_add_mask = compare_mask;
-        constructed_wr = false;
+        if (constructed_wr) {
+            patch_args();
+        }
         return *this;
     }
 
-    rdma_verb<Wr> &set_swap_mask(uint64_t swap_mask) {
+    rdma_verb &set_swap_mask(uint64_t swap_mask) {
         static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
                       "cannot set masked-CAS.swap_mask for recv verb");
         if (unlikely(opcode.has_value() &&
@@ -320,11 +497,13 @@ public:
                 "setting masked-CAS.swap_mask for non-masked-CAS verb");
         }
         this->swap_mask = swap_mask;
-        constructed_wr = false;
+        if (constructed_wr) {
+            patch_args();
+        }
         return *this;
     }
 
-    rdma_verb<Wr> &set_add(uint64_t add) {
+    rdma_verb &set_add(uint64_t add) {
         static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
                       "cannot set FAA.add for recv verb");
         if (unlikely(opcode.has_value() &&
@@ -333,11 +512,13 @@ public:
             spdlog::warn("setting FAA.add for non-FAA verb");
         }
         this->compare_add = add;
-        constructed_wr = false;
+        if (constructed_wr) {
+            patch_args();
+        }
         return *this;
     }
 
-    rdma_verb<Wr> &set_add_mask(uint64_t add_mask) {
+    rdma_verb &set_add_mask(uint64_t add_mask) {
         static_assert(std::is_same_v<Wr, ibv_exp_send_wr>,
                       "cannot set masked-FAA.add_mask for recv verb");
         if (unlikely(opcode.has_value() &&
@@ -345,31 +526,24 @@ public:
             spdlog::warn("setting masked-FAA.add_mask for non-masked-FAA verb");
         }
         this->compare_add_mask = add_mask;
-        constructed_wr = false;
+        if (constructed_wr) {
+            patch_args();
+        }
         return *this;
     }
 
     template <ibv_qp_type Type> void execute(rdma_qp<Type> const &qp);
 
-protected:
-    void construct_sgl() {
-        if (!constructed_real_sgl) {
-            real_sgl.resize(sgl.size());
-            for (size_t i = 0; i < sgl.size(); ++i) {
-                real_sgl[i] = sgl[i].to_sge();
-            }
-            constructed_real_sgl = true;
-        }
-    }
+    void execute(rdma_srq const &srq);
 
+protected:
     void construct_wr() {
-        construct_sgl();
         if (!constructed_wr) {
             wr = Wr{};
             wr.wr_id = wr_id;
             wr.next = nullptr;
-            wr.sg_list = real_sgl.data();
-            wr.num_sge = real_sgl.size();
+            wr.sg_list = sgl;
+            wr.num_sge = num_sge;
 
             if constexpr (std::is_same_v<Wr, ibv_exp_send_wr>) {
                 wr.exp_opcode = opcode.value();
@@ -390,74 +564,155 @@ protected:
                     RDMALIB2_ASSERT(remote.has_value());
                 }
 
-                if (opcode == IBV_EXP_WR_RDMA_READ ||
-                    opcode == IBV_EXP_WR_RDMA_WRITE ||
-                    opcode == IBV_EXP_WR_RDMA_WRITE_WITH_IMM) {
-                    // read/write
-                    wr.wr.rdma.remote_addr = remote->get_addr();
-                    wr.wr.rdma.rkey = remote->get_rkey();
-                } else if (opcode == IBV_EXP_WR_ATOMIC_CMP_AND_SWP ||
-                           opcode == IBV_EXP_WR_ATOMIC_FETCH_AND_ADD) {
-                    // atomics
-                    RDMALIB2_ASSERT(is_atomic_capable());
-
-                    wr.wr.atomic.remote_addr = remote->get_addr();
-                    wr.wr.atomic.rkey = remote->get_rkey();
-                    wr.wr.atomic.compare_add = compare_add;
-                    wr.wr.atomic.swap = swap;
-                } else if (opcode == IBV_EXP_WR_EXT_MASKED_ATOMIC_CMP_AND_SWP ||
-                           opcode ==
-                               IBV_EXP_WR_EXT_MASKED_ATOMIC_FETCH_AND_ADD) {
-                    // masked atomics
-                    RDMALIB2_ASSERT(is_atomic_capable());
-
-                    wr.ext_op.masked_atomics.remote_addr = remote->get_addr();
-                    wr.ext_op.masked_atomics.rkey = remote->get_rkey();
-
-                    if (opcode == IBV_EXP_WR_EXT_MASKED_ATOMIC_CMP_AND_SWP) {
-                        wr.ext_op.masked_atomics.wr_data.inline_data.op.cmp_swap
-                            .compare_val = compare_add;
-                        wr.ext_op.masked_atomics.wr_data.inline_data.op.cmp_swap
-                            .swap_val = swap;
-                        wr.ext_op.masked_atomics.wr_data.inline_data.op.cmp_swap
-                            .compare_mask = compare_add_mask;
-                        wr.ext_op.masked_atomics.wr_data.inline_data.op.cmp_swap
-                            .swap_mask = swap_mask;
-                    } else {
-                        wr.ext_op.masked_atomics.wr_data.inline_data.op
-                            .fetch_add.add_val = compare_add;
-                        wr.ext_op.masked_atomics.wr_data.inline_data.op
-                            .fetch_add.field_boundary = compare_add_mask;
-                    }
-                } else if (opcode != IBV_EXP_WR_SEND &&
-                           opcode != IBV_EXP_WR_SEND_WITH_IMM) {
+                if (unlikely(!is_atomic_opcode() && !is_inline_capable() &&
+                             opcode != IBV_EXP_WR_RDMA_READ)) {
                     spdlog::error("unsupported work request type: {}", *opcode);
                     panic();
                 }
+
+                patch_remote();
+                patch_args();
             }
 
             constructed_wr = true;
         }
     }
 
+    //! \brief Changes the opcode, which requires a full rebuild of the work
+    //! request as the opcode decides the layout of its unions.
+    void set_opcode(ibv_exp_wr_opcode op) {
+        if (opcode != op) {
+            opcode = op;
+            constructed_wr = false;
+        }
+    }
+
+    // The patch_* functions write a subset of the fields of an already
+    // constructed work request in place, so that re-posting a verb with a few
+    // changed fields does not rebuild the whole work request.
+
+    void patch_sgl() {
+        if (constructed_wr) {
+            wr.num_sge = num_sge;
+        }
+    }
+
+    void patch_remote() {
+        if (dc_dest.has_value()) {
+            // DC verbs, whose destination does not overlap the remote memory
+            wr.dc.ah = dc_dest->ah;
+            wr.dc.dct_access_key = dc_dest->dc_key;
+            wr.dc.dct_number = dc_dest->dct_number;
+        }
+        if (remote_srq.has_value()) {
+            // XRC verbs, whose target SRQ does not overlap either
+            wr.qp_type.xrc.remote_srqn = remote_srq.value();
+        }
+        if ((opcode == IBV_EXP_WR_SEND || opcode == IBV_EXP_WR_SEND_WITH_IMM) &&
+            ud_dest.has_value()) {
+            // UD sends
+            wr.wr.ud.ah = ud_dest->ah;
+            wr.wr.ud.remote_qpn = ud_dest->remote_qpn;
+            wr.wr.ud.remote_qkey = ud_dest->remote_qkey;
+            return;
+        }
+        if (!remote.has_value()) {
+            return;
+        }
+        if (opcode == IBV_EXP_WR_RDMA_READ || opcode == IBV_EXP_WR_RDMA_WRITE ||
+            opcode == IBV_EXP_WR_RDMA_WRITE_WITH_IMM) {
+            // read/write
+            wr.wr.rdma.remote_addr = remote->get_addr();
+            wr.wr.rdma.rkey = remote->get_rkey();
+        } else if (opcode == IBV_EXP_WR_ATOMIC_CMP_AND_SWP ||
+                   opcode == IBV_EXP_WR_ATOMIC_FETCH_AND_ADD) {
+            // atomics
+            wr.wr.atomic.remote_addr = remote->get_addr();
+            wr.wr.atomic.rkey = remote->get_rkey();
+        } else if (opcode == IBV_EXP_WR_EXT_MASKED_ATOMIC_CMP_AND_SWP ||
+                   opcode == IBV_EXP_WR_EXT_MASKED_ATOMIC_FETCH_AND_ADD) {
+            // masked atomics
+            wr.ext_op.masked_atomics.remote_addr = remote->get_addr();
+            wr.ext_op.masked_atomics.rkey = remote->get_rkey();
+        }
+    }
+
+    void patch_args() {
+        if (opcode == IBV_EXP_WR_ATOMIC_CMP_AND_SWP ||
+            opcode == IBV_EXP_WR_ATOMIC_FETCH_AND_ADD) {
+            wr.wr.atomic.compare_add = compare_add;
+            wr.wr.atomic.swap = swap;
+        } else if (opcode == IBV_EXP_WR_EXT_MASKED_ATOMIC_CMP_AND_SWP) {
+            auto &cmp_swap =
+                wr.ext_op.masked_atomics.wr_data.inline_data.op.cmp_swap;
+            cmp_swap.compare_val = compare_add;
+            cmp_swap.swap_val = swap;
+            cmp_swap.compare_mask = compare_add_mask;
+            cmp_swap.swap_mask = swap_mask;
+        } else if (opcode == IBV_EXP_WR_EXT_MASKED_ATOMIC_FETCH_AND_ADD) {
+            auto &fetch_add =
+                wr.ext_op.masked_atomics.wr_data.inline_data.op.fetch_add;
+            fetch_add.add_val = compare_add;
+            fetch_add.field_boundary = compare_add_mask;
+        }
+    }
+
+    bool is_atomic_opcode() const {
+        return opcode == IBV_EXP_WR_ATOMIC_CMP_AND_SWP ||
+               opcode == IBV_EXP_WR_ATOMIC_FETCH_AND_ADD ||
+               opcode == IBV_EXP_WR_EXT_MASKED_ATOMIC_CMP_AND_SWP ||
+               opcode == IBV_EXP_WR_EXT_MASKED_ATOMIC_FETCH_AND_ADD;
+    }
+
+    bool is_inline_capable() const {
+        return opcode == IBV_EXP_WR_SEND || opcode == IBV_EXP_WR_SEND_WITH_IMM ||
+               opcode == IBV_EXP_WR_RDMA_WRITE ||
+               opcode == IBV_EXP_WR_RDMA_WRITE_WITH_IMM;
+    }
+
+    bool resolve_inline(bool auto_inline, uint32_t max_inline_data) const {
+        if (has_unregistered || inlined == true) {
+            if (unlikely(!is_inline_capable())) {
+                spdlog::error("cannot inline verb with opcode {}", *opcode);
+                panic();
+            }
+            if (unlikely(length > max_inline_data)) {
+                spdlog::error("inline message length {} exceeds the QP's "
+                              "inline limit {}",
+                              length, max_inline_data);
+                panic();
+            }
+            return true;
+        }
+        if (inlined == false) {
+            return false;
+        }
+        return auto_inline && length <= max_inline_data && is_inline_capable();
+    }
+
     bool is_atomic_capable() const {
-        return length == sizeof(uint64_t) && sgl.size() == 1 &&
-               sgl[0].is_aligned();
+        return length == sizeof(uint64_t) && num_sge == 1 &&
+               sgl[0].addr % sizeof(uint64_t) == 0;
     }
 
-    // Cached sglist & work request
-    std::vector<ibv_sge> real_sgl = {};
-    bool constructed_real_sgl = false;
+    // Cached work request, whose sg_list points into `sgl`. Once constructed,
+    // it is patched in place by the setters until the opcode changes.
     Wr wr;
     bool constructed_wr = false;
 
     // Original information
-    uint64_t wr_id;
+    uint64_t wr_id = 0;
     std::optional<ibv_exp_wr_opcode> opcode = std::nullopt;
-    std::vector<rdma_memory_slice> sgl = {};
+    ibv_sge sgl[MaxSge];
+    uint32_t num_sge = 0;
     size_t length = 0;
+    bool has_unregistered = false;
     std::optional<rdma_remote_memory_slice> remote = std::nullopt;
+    std::optional<rdma_ud_dest> ud_dest = std::nullopt;
+    std::optional<rdma_dc_dest> dc_dest = std::nullopt;
+    std::optional<uint32_t> remote_srq = std::nullopt;
     bool notified = false;
+    std::optional<bool> inlined = std::nullopt;
     bool carry_imm = false;
     uint32_t imm_data = 0;
     uint64_t compare_add = 0;
@@ -466,9 +721,422 @@ protected:
     uint64_t swap_mask = 0;
 };
 
+//! \brief A send verb whose opcode is fixed at compile time.
+//!
+//! Instead of caching a work request rebuilt from scratch after each change,
+//! the work request is always kept up to date: every setter writes only the
+//! fields relevant to `Opcode`, and setters that make no sense for it are
+//! rejected at compile time.
+template <ibv_exp_wr_opcode Opcode, uint32_t MaxSge>
+class rdma_verb<wr_type_base<Opcode>, MaxSge> {
+    static_assert(MaxSge > 0, "scatter-gather list capacity must be positive");
+    static_assert(MaxSge <= kMaxSge,
+                  "scatter-gather list capacity exceeds QP limit kMaxSge");
+
+    static constexpr bool is_send = Opcode == IBV_EXP_WR_SEND ||
+                                    Opcode == IBV_EXP_WR_SEND_WITH_IMM;
+    static constexpr bool is_rdma = Opcode == IBV_EXP_WR_RDMA_WRITE ||
+                                    Opcode == IBV_EXP_WR_RDMA_WRITE_WITH_IMM ||
+                                    Opcode == IBV_EXP_WR_RDMA_READ;
+    static constexpr bool is_atomic =
+        Opcode == IBV_EXP_WR_ATOMIC_CMP_AND_SWP ||
+        Opcode == IBV_EXP_WR_ATOMIC_FETCH_AND_ADD;
+    static constexpr bool is_masked_atomic =
+        Opcode == IBV_EXP_WR_EXT_MASKED_ATOMIC_CMP_AND_SWP ||
+        Opcode == IBV_EXP_WR_EXT_MASKED_ATOMIC_FETCH_AND_ADD;
+    static constexpr bool has_imm = Opcode == IBV_EXP_WR_SEND_WITH_IMM ||
+                                    Opcode == IBV_EXP_WR_RDMA_WRITE_WITH_IMM;
+    static constexpr bool is_inline_capable =
+        is_send || Opcode == IBV_EXP_WR_RDMA_WRITE ||
+        Opcode == IBV_EXP_WR_RDMA_WRITE_WITH_IMM;
+
+    static_assert(is_send || is_rdma || is_atomic || is_masked_atomic,
+                  "unsupported work request type");
+
+public:
+    // Expose work request type for public use
+    using wr_type = ibv_exp_send_wr;
+    static constexpr uint32_t max_sge = MaxSge;
+    static constexpr bool is_typed = true;
+    static constexpr ibv_exp_wr_opcode fixed_opcode = Opcode;
+
+public:
+    rdma_verb() {
+        wr.exp_opcode = Opcode;
+        wr.sg_list = sgl;
+        if constexpr (is_masked_atomic) {
+            // 8-byte arguments
+            wr.ext_op.masked_atomics.log_arg_sz = 3;
+        }
+    }
+
+    template <typename... MemSlices>
+    rdma_verb(rdma_memory_slice const &head, MemSlices const &...tail)
+        : rdma_verb() {
+        set_sgl_entry(head, tail...);
+    }
+
+    rdma_verb(rdma_verb const &other)
+        : wr(other.wr),
+          wr_id(other.wr_id),
+          length(other.length),
+          has_unregistered(other.has_unregistered),
+          notified(other.notified),
+          inlined(other.inlined),
+          ah_pin(other.ah_pin) {
+        std::copy_n(other.sgl, other.wr.num_sge, sgl);
+        wr.sg_list = sgl;
+        wr.next = nullptr;
+    }
+
+    rdma_verb(rdma_verb &&other) noexcept : rdma_verb(other) {}
+
+    rdma_verb &operator=(rdma_verb const &other) & {
+        if (this != &other) {
+            this->~rdma_verb();
+            new (this) rdma_verb(other);
+        }
+        return *this;
+    }
+
+    rdma_verb &operator=(rdma_verb &&other) & noexcept {
+        return *this = other;
+    }
+
+    ~rdma_verb() = default;
+
+    //! \brief Gets the work request, which is always up to date.
+    ibv_exp_send_wr const &get_wr() {
+        wr.next = nullptr;
+        return wr;
+    }
+
+    //! \brief Gets the work request with the inline flag resolved against a
+    //! QP's inline policy.
+    ibv_exp_send_wr const &get_wr(bool auto_inline, uint32_t max_inline_data) {
+        get_wr();
+        if constexpr (is_inline_capable) {
+            if (resolve_inline(auto_inline, max_inline_data)) {
+                wr.exp_send_flags |= IBV_EXP_SEND_INLINE;
+            } else {
+                wr.exp_send_flags &= ~IBV_EXP_SEND_INLINE;
+            }
+        }
+        return wr;
+    }
+
+    //! \brief Temporarily sets the next work request in the chain.
+    //! The next work request pointer will be reset after the next call to
+    //! get_wr().
+    template <typename Verb> rdma_verb &set_next(Verb &next) {
+        wr.next = const_cast<ibv_exp_send_wr *>(&next.get_wr());
+        return *this;
+    }
+
+    //! \brief Clears the next work request pointer.
+    rdma_verb &clear_next() {
+        wr.next = nullptr;
+        return *this;
+    }
+
+    //! \brief Sets the work request ID.
+    rdma_verb &set_id(uint64_t id) {
+        wr_id = id;
+        wr.wr_id = id;
+        return *this;
+    }
+
+    //! \brief Gets the work request ID.
+    uint64_t get_id() const { return wr_id; }
+
+    //! \brief Gets the opcode.
+    static constexpr std::optional<ibv_exp_wr_opcode> get_op() {
+        return Opcode;
+    }
+
+    //! \brief Sets the scatter-gather list.
+    //!
+    //! Each parameter accounts for a scatter-gather list entry.
+    //! The original scatter-gather list will be cleared.
+    template <typename... MemSlice>
+    rdma_verb &set_sgl_entry(MemSlice const &...slices) {
+        clear_sgl();
+        return add_sgl_entry(slices...);
+    }
+
+    //! \brief Clears the scatter-gather list.
+    rdma_verb &clear_sgl() {
+        wr.num_sge = 0;
+        length = 0;
+        has_unregistered = false;
+        return *this;
+    }
+
+    //! \brief Appends entries to the scatter-gather list.
+    template <typename... MemSlice>
+    rdma_verb &add_sgl_entry(rdma_memory_slice const &head,
+                             MemSlice const &...tail) {
+        // reject long sg-lists at compile time
+        static_assert(1 + sizeof...(tail) <= MaxSge,
+                      "too many scatter-gather list entries");
+        static_assert(!(is_atomic || is_masked_atomic) || sizeof...(tail) == 0,
+                      "atomic verbs take exactly one scatter-gather entry");
+        // then, we can only prevent long sg-lists at runtime
+        RDMALIB2_ASSERT(wr.num_sge < static_cast<int>(MaxSge));
+
+        sgl[wr.num_sge++] = head.to_sge();
+        length += head.get_size();
+        if constexpr (is_atomic || is_masked_atomic) {
+            RDMALIB2_ASSERT(wr.num_sge == 1 &&
+                            head.get_size() == sizeof(uint64_t) &&
+                            head.is_aligned());
+        }
+        if constexpr (sizeof...(tail) == 0) {
+            return *this;
+        } else {
+            return add_sgl_entry(tail...);
+        }
+    }
+
+    //! \brief Appends an entry pointing to memory that is not registered.
+    //!
+    //! The payload is copied into the work queue entry at post time, so the
+    //! verb is always posted inline.
+    rdma_verb &add_unregistered_entry(void const *buf, size_t size) {
+        static_assert(is_inline_capable,
+                      "only send/write verbs can use unregistered memory");
+        RDMALIB2_ASSERT(wr.num_sge < static_cast<int>(MaxSge));
+
+        sgl[wr.num_sge++] = {.addr = reinterpret_cast<uint64_t>(buf),
+                             .length = static_cast<uint32_t>(size),
+                             .lkey = 0};
+        length += size;
+        has_unregistered = true;
+        return *this;
+    }
+
+    //! \brief Gets the number of scatter-gather list entries.
+    uint32_t get_num_sge() const { return wr.num_sge; }
+
+    size_t get_total_msg_length() const { return length; }
+
+    rdma_verb &set_remote_memory(rdma_remote_memory_slice const &remote) {
+        static_assert(!is_send, "cannot set remote memory for send verb");
+        if constexpr (is_rdma) {
+            wr.wr.rdma.remote_addr = remote.get_addr();
+            wr.wr.rdma.rkey = remote.get_rkey();
+        } else if constexpr (is_atomic) {
+            wr.wr.atomic.remote_addr = remote.get_addr();
+            wr.wr.atomic.rkey = remote.get_rkey();
+        } else {
+            wr.ext_op.masked_atomics.remote_addr = remote.get_addr();
+            wr.ext_op.masked_atomics.rkey = remote.get_rkey();
+        }
+        return *this;
+    }
+
+    //! \brief Sets the destination of a send verb posted to a UD QP.
+    rdma_verb &set_ud_dest(rdma_ud_dest const &dest) {
+        static_assert(is_send, "cannot set UD destination for non-send verb");
+        wr.wr.ud.ah = dest.ah;
+        wr.wr.ud.remote_qpn = dest.remote_qpn;
+        wr.wr.ud.remote_qkey = dest.remote_qkey;
+        ah_pin = dest.pin;
+        return *this;
+    }
+
+    //! \brief Sets the destination of a verb posted to a DC initiator.
+    rdma_verb &set_dc_dest(rdma_dc_dest const &dest) {
+        wr.dc.ah = dest.ah;
+        wr.dc.dct_access_key = dest.dc_key;
+        wr.dc.dct_number = dest.dct_number;
+        ah_pin = dest.pin;
+        return *this;
+    }
+
+    //! \brief Sets the number of the remote XRC SRQ that a verb posted to
+    //! an XRC send QP is delivered to.
+    rdma_verb &set_remote_srq(uint32_t srq_num) {
+        wr.qp_type.xrc.remote_srqn = srq_num;
+        return *this;
+    }
+
+    rdma_verb &set_notify(bool notify) {
+        notified = notify;
+        if (notify) {
+            wr.exp_send_flags |= IBV_EXP_SEND_SIGNALED;
+        } else {
+            wr.exp_send_flags &= ~IBV_EXP_SEND_SIGNALED;
+        }
+        return *this;
+    }
+
+    rdma_verb &set_notified() { return set_notify(true); }
+
+    rdma_verb &set_unnotified() { return set_notify(false); }
+
+    bool is_notified() const { return notified; }
+
+    //! \brief Forces inlining on or off for this verb, overriding the QP's
+    //! inline policy.
+    rdma_verb &set_inline(bool inline_data) {
+        static_assert(is_inline_capable, "only send/write verbs can inline");
+        inlined = inline_data;
+        return *this;
+    }
+
+    rdma_verb &set_inlined() { return set_inline(true); }
+
+    rdma_verb &set_uninlined() { return set_inline(false); }
+
+    //! \brief Lets the QP's inline policy decide whether to inline this verb.
+    rdma_verb &clear_inline() {
+        inlined = std::nullopt;
+        return *this;
+    }
+
+    std::optional<bool> get_inline() const { return inlined; }
+
+    rdma_verb &set_imm(uint32_t imm_data) {
+        static_assert(has_imm, "cannot set immediate data for non-imm verb");
+        wr.ex.imm_data = imm_data;
+        return *this;
+    }
+
+    rdma_verb &set_cas(uint64_t compare, uint64_t swap) {
+        return set_compare(compare).set_swap(swap);
+    }
+
+    rdma_verb &set_faa(uint64_t add) { return set_add(add); }
+
+    rdma_verb &set_masked_cas(uint64_t compare, uint64_t swap,
+                              uint64_t compare_mask, uint64_t swap_mask) {
+        return set_compare(compare)
+            .set_swap(swap)
+            .set_compare_mask(compare_mask)
+            .set_swap_mask(swap_mask);
+    }
+
+    rdma_verb &set_masked_faa(uint64_t add, uint64_t add_mask) {
+        return set_add(add).set_add_mask(add_mask);
+    }
+
+    rdma_verb &set_compare(uint64_t compare) {
+        if constexpr (Opcode == IBV_EXP_WR_ATOMIC_CMP_AND_SWP) {
+            wr.wr.atomic.compare_add = compare;
+        } else if constexpr (Opcode ==
+                             IBV_EXP_WR_EXT_MASKED_ATOMIC_CMP_AND_SWP) {
+            wr.ext_op.masked_atomics.wr_data.inline_data.op.cmp_swap
+                .compare_val = compare;
+        } else {
+            static_assert(Opcode == IBV_EXP_WR_ATOMIC_CMP_AND_SWP,
+                          "cannot set CAS.compare for non-CAS verb");
+        }
+        return *this;
+    }
+
+    rdma_verb &set_swap(uint64_t swap) {
+        if constexpr (Opcode == IBV_EXP_WR_ATOMIC_CMP_AND_SWP) {
+            wr.wr.atomic.swap = swap;
+        } else if constexpr (Opcode ==
+                             IBV_EXP_WR_EXT_MASKED_ATOMIC_CMP_AND_SWP) {
+            wr.ext_op.masked_atomics.wr_data.inline_data.op.cmp_swap
+                .swap_val = swap;
+        } else {
+            static_assert(Opcode == IBV_EXP_WR_ATOMIC_CMP_AND_SWP,
+                          "cannot set CAS.swap for non-CAS verb");
+        }
+        return *this;
+    }
+
+    rdma_verb &set_compare_mask(uint64_t compare_mask) {
+        static_assert(Opcode == IBV_EXP_WR_EXT_MASKED_ATOMIC_CMP_AND_SWP,
+                      "cannot set masked-CAS.compare_mask for non-masked-CAS "
+                      "verb");
+        wr.ext_op.masked_atomics.wr_data.inline_data.op.cmp_swap.compare_mask =
+            compare_mask;
+        return *this;
+    }
+
+    rdma_verb &set_swap_mask(uint64_t swap_mask) {
+        static_assert(Opcode == IBV_EXP_WR_EXT_MASKED_ATOMIC_CMP_AND_SWP,
+                      "cannot set masked-CAS.swap_mask for non-masked-CAS "
+                      "verb");
+        wr.ext_op.masked_atomics.wr_data.inline_data.op.cmp_swap.swap_mask =
+            swap_mask;
+        return *this;
+    }
+
+    rdma_verb &set_add(uint64_t add) {
+        if constexpr (Opcode == IBV_EXP_WR_ATOMIC_FETCH_AND_ADD) {
+            wr.wr.atomic.compare_add = add;
+        } else if constexpr (Opcode ==
+                             IBV_EXP_WR_EXT_MASKED_ATOMIC_FETCH_AND_ADD) {
+            wr.ext_op.masked_atomics.wr_data.inline_data.op.fetch_add.add_val =
+                add;
+        } else {
+            static_assert(Opcode == IBV_EXP_WR_ATOMIC_FETCH_AND_ADD,
+                          "cannot set FAA.add for non-FAA verb");
+        }
+        return *this;
+    }
+
+    rdma_verb &set_add_mask(uint64_t add_mask) {
+        static_assert(Opcode == IBV_EXP_WR_EXT_MASKED_ATOMIC_FETCH_AND_ADD,
+                      "cannot set masked-FAA.add_mask for non-masked-FAA verb");
+        wr.ext_op.masked_atomics.wr_data.inline_data.op.fetch_add
+            .field_boundary = add_mask;
+        return *this;
+    }
+
+    template <ibv_qp_type Type> void execute(rdma_qp<Type> const &qp);
+
+protected:
+    bool resolve_inline(bool auto_inline, uint32_t max_inline_data) const {
+        if (has_unregistered || inlined == true) {
+            if (unlikely(length > max_inline_data)) {
+                spdlog::error("inline message length {} exceeds the QP's "
+                              "inline limit {}",
+                              length, max_inline_data);
+                panic();
+            }
+            return true;
+        }
+        if (inlined == false) {
+            return false;
+        }
+        return auto_inline && length <= max_inline_data;
+    }
+
+    // Always-constructed work request, whose sg_list points into `sgl`
+    ibv_exp_send_wr wr = {};
+    ibv_sge sgl[MaxSge];
+
+    uint64_t wr_id = 0;
+    size_t length = 0;
+    bool has_unregistered = false;
+    bool notified = false;
+    std::optional<bool> inlined = std::nullopt;
+
+    // Address handle of the destination, if it came from a cache
+    std::shared_ptr<ibv_ah> ah_pin;
+};
+
 typedef rdma_verb<ibv_exp_send_wr> rdma_send_family;
 typedef rdma_verb<ibv_recv_wr> rdma_recv;
 
+typedef rdma_verb<wr_type_base<IBV_EXP_WR_SEND>> rdma_send;
+typedef rdma_verb<wr_type_base<IBV_EXP_WR_SEND_WITH_IMM>> rdma_send_imm;
+typedef rdma_verb<wr_type_base<IBV_EXP_WR_RDMA_WRITE>> rdma_write;
+typedef rdma_verb<wr_type_base<IBV_EXP_WR_RDMA_WRITE_WITH_IMM>> rdma_write_imm;
+typedef rdma_verb<wr_type_base<IBV_EXP_WR_RDMA_READ>> rdma_read;
+typedef rdma_verb<wr_type_base<IBV_EXP_WR_ATOMIC_CMP_AND_SWP>, 1> rdma_cas;
+typedef rdma_verb<wr_type_base<IBV_EXP_WR_ATOMIC_FETCH_AND_ADD>, 1> rdma_faa;
+typedef rdma_verb<wr_type_base<IBV_EXP_WR_EXT_MASKED_ATOMIC_CMP_AND_SWP>, 1>
+    rdma_masked_cas;
+typedef rdma_verb<wr_type_base<IBV_EXP_WR_EXT_MASKED_ATOMIC_FETCH_AND_ADD>, 1>
+    rdma_masked_faa;
+
 } // namespace rdmalib2
 
 #endif // __RDMALIB2_PREDECLARE_VERB_H__
@@ -10,8 +10,10 @@
 namespace rdmalib2 {
 
 template <ibv_qp_type Type>
-template <typename Wr>
-void rdma_qp<Type>::post_verb(rdma_verb<Wr> &verb) const {
+template <typename Tag, uint32_t MaxSge>
+void rdma_qp<Type>::post_verb(rdma_verb<Tag, MaxSge> &verb) const {
+    using Verb = rdma_verb<Tag, MaxSge>;
+    using Wr = typename Verb::wr_type;
     static_assert(std::is_same_v<Wr, ibv_exp_send_wr> ||
                       std::is_same_v<Wr, ibv_recv_wr>,
                   "Unknown work request type");
@@ -19,11 +21,26 @@ void rdma_qp<Type>::post_verb(rdma_verb<Wr> &verb) const {
     Wr *bad_wr = nullptr;
 
     if constexpr (std::is_same_v<Wr, ibv_exp_send_wr>) {
-        RDMALIB2_ASSERT(verb.get_op().has_value());
-        RDMALIB2_ASSERT((qp_verb_compat<Type, Wr>{})(*(verb.get_op())));
-        ret = ibv_exp_post_send(qp, const_cast<Wr *>(&verb.get_wr()), &bad_wr);
+        if constexpr (Verb::is_typed) {
+            static_assert((qp_verb_compat<Type, Wr>{})(Verb::fixed_opcode),
+                          "verb opcode is not supported by this QP type");
+        } else {
+            RDMALIB2_ASSERT(verb.get_op().has_value());
+            RDMALIB2_ASSERT((qp_verb_compat<Type, Wr>{})(*(verb.get_op())));
+        }
+        Wr &wr = const_cast<Wr &>(verb.get_wr(auto_inline, max_inline_data));
+        if (sq_tracker) {
+            wait_for_sq(1);
+        }
+        // Always rewrite the signaling, since the cached work request may
+        // carry a tagged wr_id from an earlier post on a tracked QP
+        apply_signaling(verb.get_id(), verb.is_notified(), wr);
+        ret = ibv_exp_post_send(qp, &wr, &bad_wr);
     }
     if constexpr (std::is_same_v<Wr, ibv_recv_wr>) {
+        static_assert(Type != IBV_QPT_XRC_SEND && Type != IBV_QPT_XRC_RECV,
+                      "XRC QPs receive through XRC SRQs");
+        RDMALIB2_ASSERT(!srq);
         ret = ibv_post_recv(qp, const_cast<Wr *>(&verb.get_wr()), &bad_wr);
     }
 
@@ -38,19 +55,57 @@ void rdma_qp<Type>::post_verb(rdma_verb<Wr> &verb) const {
 template <ibv_qp_type Type>
 template <typename ForwardIt>
 void rdma_qp<Type>::post_verb(ForwardIt first, ForwardIt last) const {
-    using Wr =
-        typename std::remove_cv_t<std::decay_t<decltype(*first)>>::wr_type;
+    using Verb = std::remove_cv_t<std::decay_t<decltype(*first)>>;
+    using Wr = typename Verb::wr_type;
     static_assert(std::is_same_v<Wr, ibv_exp_send_wr> ||
                       std::is_same_v<Wr, ibv_recv_wr>,
                   "Unknown work request type");
 
+    if (first == last) {
+        return;
+    }
+    if constexpr (std::is_same_v<Wr, ibv_exp_send_wr>) {
+        if (sq_tracker) {
+            // Larger posts could wait forever for the slots of trailing
+            // unsignaled work requests, so split them
+            size_t max_post = sq_tracker->get_max_post();
+            size_t n = std::distance(first, last);
+            if (unlikely(n > max_post)) {
+                while (first != last) {
+                    ForwardIt mid = first;
+                    std::advance(mid, std::min(n, max_post));
+                    post_verb(first, mid);
+                    n -= std::min(n, max_post);
+                    first = mid;
+                }
+                return;
+            }
+            wait_for_sq(n);
+        }
+    }
+
     // Temporarily chain the work requests together
+    Wr *head = nullptr;
     for (ForwardIt it = first; it != last; ++it) {
-        RDMALIB2_ASSERT((*it).get_op().has_value());
-        RDMALIB2_ASSERT((qp_verb_compat<Type, Wr>{})(*((*it).get_op())));
+        auto &wr =
+            const_cast<Wr &>((*it).get_wr(auto_inline, max_inline_data));
+        if constexpr (std::is_same_v<Wr, ibv_exp_send_wr>) {
+            if constexpr (Verb::is_typed) {
+                static_assert(
+                    (qp_verb_compat<Type, Wr>{})(Verb::fixed_opcode),
+                    "verb opcode is not supported by this QP type");
+            } else {
+                RDMALIB2_ASSERT((*it).get_op().has_value());
+                RDMALIB2_ASSERT(
+                    (qp_verb_compat<Type, Wr>{})(*((*it).get_op())));
+            }
+            apply_signaling((*it).get_id(), (*it).is_notified(), wr);
+        }
+        if (!head) {
+            head = &wr;
+        }
 
         auto next = std::next(it);
-        (*it).get_wr();
         if (next != last) {
             (*it).set_next(*next);
         } else {
@@ -62,10 +117,13 @@ void rdma_qp<Type>::post_verb(ForwardIt first, ForwardIt last) const {
     Wr *bad_wr = nullptr;
 
     if constexpr (std::is_same_v<Wr, ibv_exp_send_wr>) {
-        ret = ibv_exp_post_send(qp, &(*first).get_wr(), &bad_wr);
+        ret = ibv_exp_post_send(qp, head, &bad_wr);
     }
     if constexpr (std::is_same_v<Wr, ibv_recv_wr>) {
-        ret = ibv_post_recv(qp, &(*first).get_wr(), &bad_wr);
+        static_assert(Type != IBV_QPT_XRC_SEND && Type != IBV_QPT_XRC_RECV,
+                      "XRC QPs receive through XRC SRQs");
+        RDMALIB2_ASSERT(!srq);
+        ret = ibv_post_recv(qp, head, &bad_wr);
     }
 
     if (unlikely(ret)) {
@@ -81,6 +139,65 @@ void rdma_qp<Type>::post_verb(ForwardIt first, ForwardIt last) const {
     }
 }
 
+template <ibv_qp_type Type>
+template <size_t N, uint32_t MaxSge>
+void rdma_qp<Type>::post_verb(rdma_verb_batch<N, MaxSge> &batch) const {
+    size_t size = batch.size();
+    if (unlikely(size == 0)) {
+        return;
+    }
+
+    // RC QPs accept every opcode, so only check the others
+    if constexpr (Type != IBV_QPT_RC) {
+        for (size_t i = 0; i < size; ++i) {
+            RDMALIB2_ASSERT((qp_verb_compat<Type, ibv_exp_send_wr>{})(
+                batch.get_wr(i).exp_opcode));
+        }
+    }
+
+    // Posts slots [first, last) behind one doorbell
+    auto post_range = [this, &batch](size_t first, size_t last) {
+        ibv_exp_send_wr &tail = batch.get_wr(last - 1);
+        ibv_exp_send_wr *next = tail.next;
+        tail.next = nullptr;
+        ibv_exp_send_wr *bad_wr = nullptr;
+        int ret = ibv_exp_post_send(qp, &batch.get_wr(first), &bad_wr);
+        tail.next = next;
+        if (unlikely(ret)) {
+            spdlog::error("post batch of {} send verbs failed with return "
+                          "value {}",
+                          last - first, ret);
+            panic_with_errno();
+        }
+    };
+
+    if (sq_tracker) {
+        // Larger posts could wait forever for the slots of trailing
+        // unsignaled work requests, so split them
+        size_t max_post = sq_tracker->get_max_post();
+        for (size_t first = 0; first < size; first += max_post) {
+            size_t last = std::min(first + max_post, size);
+            wait_for_sq(last - first);
+            for (size_t i = first; i < last; ++i) {
+                apply_signaling(batch.get_id(i), batch.is_notified(i),
+                                batch.get_wr(i));
+            }
+            post_range(first, last);
+        }
+        batch.signaling_patched = true;
+        return;
+    }
+
+    if (unlikely(batch.signaling_patched)) {
+        for (size_t i = 0; i < size; ++i) {
+            apply_signaling(batch.get_id(i), batch.is_notified(i),
+                            batch.get_wr(i));
+        }
+        batch.signaling_patched = false;
+    }
+    post_range(0, size);
+}
+
 } // namespace rdmalib2
 
 #endif // __RDMALIB2_QP_H__
@@ -0,0 +1,96 @@
+#pragma once
+
+#ifndef __RDMALIB2_QP_CONFIG_H__
+#define __RDMALIB2_QP_CONFIG_H__
+
+#include "context.h"
+#include <algorithm>
+
+namespace rdmalib2 {
+
+//! \brief Runtime QP parameters, passed at QP construction.
+//!
+//! The defaults reproduce the library's historical behavior. Parameters
+//! bounded by the device are clamped to its limits with a warning when the
+//! QP is created, and the path MTU is clamped to the active MTU of the port
+//! when the QP is connected. Parameters outside their protocol range are
+//! rejected.
+struct rdma_qp_config {
+    //! Send and receive queue depth
+    uint32_t depth = kQpDepth;
+    //! Scatter-gather entries per work request
+    uint32_t max_sge = kMaxSge;
+    uint32_t max_inline_data = kMaxInlineData;
+
+    ibv_mtu path_mtu = IBV_MTU_4096;
+    //! Local ACK timeout, 4.096 us * 2^timeout (0 for infinite)
+    uint8_t timeout = 14;
+    uint8_t retry_cnt = 7;
+    //! RNR retry count (7 for infinite)
+    uint8_t rnr_retry = 6;
+    //! Minimal RNR NAK timer code
+    uint8_t min_rnr_timer = 12;
+    //! Outstanding RDMA reads and atomics as the initiator
+    uint8_t max_rd_atomic = 16;
+    //! Outstanding RDMA reads and atomics as the responder
+    uint8_t max_dest_rd_atomic = 16;
+
+    //! \brief Validates the configuration and clamps it to the device limits.
+    rdma_qp_config clamp_to_device(rdma_context const &ctx) const {
+        validate();
+
+        auto const &attr = ctx.get_device_attr();
+        rdma_qp_config ret = *this;
+        clamp_field("depth", ret.depth, attr.max_qp_wr);
+        clamp_field("max_sge", ret.max_sge, attr.max_sge);
+        clamp_field("max_rd_atomic", ret.max_rd_atomic,
+                    attr.max_qp_init_rd_atom);
+        clamp_field("max_dest_rd_atomic", ret.max_dest_rd_atomic,
+                    attr.max_qp_rd_atom);
+        return ret;
+    }
+
+    //! \brief Clamps the path MTU to the active MTU of a port.
+    rdma_qp_config clamp_to_port(rdma_context const &ctx, uint8_t port) const {
+        rdma_qp_config ret = *this;
+        ibv_mtu active_mtu = ctx.get_port_attr(port).active_mtu;
+        if (ret.path_mtu > active_mtu) {
+            spdlog::warn("clamping path MTU {} to the active MTU {} of port {}",
+                         mtu_to_bytes(ret.path_mtu), mtu_to_bytes(active_mtu),
+                         port);
+            ret.path_mtu = active_mtu;
+        }
+        return ret;
+    }
+
+protected:
+    void validate() const {
+        if (depth == 0 || max_sge == 0 || timeout > 31 || retry_cnt > 7 ||
+            rnr_retry > 7 || min_rnr_timer > 31 || path_mtu < IBV_MTU_256 ||
+            path_mtu > IBV_MTU_4096) {
+            spdlog::error("invalid QP configuration <depth {}, max_sge {}, "
+                          "path_mtu {}, timeout {}, retry_cnt {}, rnr_retry "
+                          "{}, min_rnr_timer {}>",
+                          depth, max_sge, static_cast<int>(path_mtu), timeout,
+                          retry_cnt, rnr_retry, min_rnr_timer);
+            panic();
+        }
+    }
+
+    template <typename T>
+    static void clamp_field(char const *name, T &value, int limit) {
+        if (limit >= 0 && value > static_cast<uint32_t>(limit)) {
+            spdlog::warn("clamping QP {} {} to device limit {}", name, value,
+                         limit);
+            value = static_cast<T>(limit);
+        }
+    }
+
+    static constexpr uint32_t mtu_to_bytes(ibv_mtu mtu) {
+        return 128u << mtu;
+    }
+};
+
+} // namespace rdmalib2
+
+#endif // __RDMALIB2_QP_CONFIG_H__
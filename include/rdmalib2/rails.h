@@ -0,0 +1,420 @@
+#pragma once
+
+#ifndef __RDMALIB2_RAILS_H__
+#define __RDMALIB2_RAILS_H__
+
+#include "context.h"
+#include "cq.h"
+#include "mem.h"
+#include "qp.h"
+#include "qp_config.h"
+#include "verb.h"
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rdmalib2 {
+
+//! \brief A rail, i.e., a port of a device.
+struct rdma_rail_spec {
+    //! Device name; empty picks the first device
+    std::string device;
+    uint8_t port = 1;
+};
+
+//! \brief The handle of a transfer striped over several rails, done once
+//! every stripe has completed.
+//!
+//! The handle serves as the wr_id of its stripes, so it must stay in place
+//! until it is done.
+class rdma_rail_transfer {
+    friend class rdma_rails;
+    friend class rdma_rail_peer;
+
+public:
+    rdma_rail_transfer() = default;
+
+    rdma_rail_transfer(rdma_rail_transfer const &) = delete;
+    rdma_rail_transfer &operator=(rdma_rail_transfer const &) = delete;
+
+    rdma_rail_transfer(rdma_rail_transfer &&) = delete;
+    rdma_rail_transfer &operator=(rdma_rail_transfer &&) = delete;
+
+    ~rdma_rail_transfer() = default;
+
+    bool is_done() const { return pending == 0; }
+
+    //! \brief Gets the number of rails the transfer was striped over.
+    uint32_t get_num_stripes() const { return num_stripes; }
+
+protected:
+    uint32_t pending = 0;
+    uint32_t num_stripes = 0;
+    // Bytes carried by each rail and its work requests still in flight,
+    // indexed by rail
+    size_t stripe_sizes[kMaxRails] = {};
+    uint32_t stripe_wrs[kMaxRails] = {};
+};
+
+//! \brief A set of rails, which may span several devices and several ports
+//! of each device, to aggregate their bandwidth.
+//!
+//! Each device is opened once and every rail gets a CQ shared by the QPs of
+//! all peers on it. The set keeps track of the bytes and work requests in
+//! flight on each rail, which `rdma_rail_peer` stripes transfers by; the
+//! work requests in flight on a rail are capped at the QP depth clamped to
+//! its device, so no QP of the rail can overflow. Completions are merged
+//! with `poll()`.
+class rdma_rails {
+    friend class rdma_rail_peer;
+
+public:
+    rdma_rails(std::vector<rdma_rail_spec> const &specs,
+               rdma_qp_config const &config = {}) {
+        RDMALIB2_ASSERT(!specs.empty() && specs.size() <= kMaxRails);
+        std::vector<std::string> names;
+        rails.reserve(specs.size());
+        for (auto const &spec : specs) {
+            auto it = std::find(names.begin(), names.end(), spec.device);
+            size_t device = it - names.begin();
+            if (it == names.end()) {
+                names.push_back(spec.device);
+                contexts.push_back(
+                    std::make_unique<rdma_context>(spec.device));
+                configs.push_back(config.clamp_to_device(*contexts.back()));
+            }
+            rails.push_back(std::make_unique<rail>(
+                *contexts[device], device, spec.port, configs[device]));
+            spdlog::trace("rail {} on port {} of device {}",
+                          rails.size() - 1, spec.port,
+                          ibv_get_device_name(
+                              contexts[device]->get_context()->device));
+        }
+    }
+
+    // Peers refer to the contexts and CQs of the rails
+    rdma_rails(rdma_rails const &) = delete;
+    rdma_rails &operator=(rdma_rails const &) = delete;
+
+    rdma_rails(rdma_rails &&) = delete;
+    rdma_rails &operator=(rdma_rails &&) = delete;
+
+    ~rdma_rails() = default;
+
+    size_t size() const { return rails.size(); }
+
+    size_t get_num_devices() const { return contexts.size(); }
+
+    rdma_context const &get_device_context(size_t device) const {
+        return *contexts[device];
+    }
+
+    rdma_context const &get_context(size_t i) const { return rails[i]->ctx; }
+
+    //! \brief Gets the index of the device a rail belongs to.
+    size_t get_device(size_t i) const { return rails[i]->device; }
+
+    uint8_t get_port(size_t i) const { return rails[i]->port; }
+
+    rdma_cq const &get_cq(size_t i) const { return rails[i]->cq; }
+
+    //! \brief Gets the QP configuration of a rail, clamped to its device.
+    rdma_qp_config const &get_config(size_t i) const {
+        return configs[rails[i]->device];
+    }
+
+    //! \brief Gets the bytes in flight on a rail.
+    size_t get_outstanding_bytes(size_t i) const {
+        return rails[i]->outstanding_bytes;
+    }
+
+    //! \brief Polls every rail, crediting each completion to its transfer.
+    //!
+    //! \return The number of stripes completed.
+    int poll(int num_entries = kMaxPollCq) {
+        int ret = 0;
+        for (auto &r : rails) {
+            size_t i = &r - rails.data();
+            ret += r->cq.try_poll_with_wc(
+                [&r, i](rdma_success_cqe const &cqe) {
+                    auto *t = reinterpret_cast<rdma_rail_transfer *>(
+                        cqe.wr_id);
+                    --r->outstanding_wrs;
+                    if (--t->stripe_wrs[i] == 0) {
+                        r->outstanding_bytes -= t->stripe_sizes[i];
+                    }
+                    --t->pending;
+                },
+                num_entries);
+        }
+        return ret;
+    }
+
+    //! \brief Polls until a transfer is done.
+    void wait(rdma_rail_transfer const &t) {
+        while (!t.is_done()) {
+            poll();
+        }
+    }
+
+protected:
+    struct rail {
+        rail(rdma_context const &ctx, size_t device, uint8_t port,
+             rdma_qp_config const &config)
+            : ctx(ctx),
+              device(device),
+              port(port),
+              depth(config.depth),
+              max_msg_size(ctx.get_port_attr(port).max_msg_sz),
+              cq(ctx, static_cast<int>(config.depth)) {}
+
+        rdma_context const &ctx;
+        size_t device;
+        uint8_t port;
+        uint32_t depth;
+        size_t max_msg_size;
+        rdma_cq cq;
+        size_t outstanding_bytes = 0;
+        uint32_t outstanding_wrs = 0;
+    };
+
+    struct stripe {
+        size_t rail;
+        size_t offset;
+        size_t size;
+    };
+
+    //! \brief Splits `size` bytes over the least loaded rails, so that
+    //! their bytes in flight even out, without going below
+    //! `kRailStripeMin` per stripe.
+    //!
+    //! \return The number of stripes.
+    size_t plan(size_t size, stripe (&out)[kMaxRails]) const {
+        size_t order[kMaxRails];
+        size_t n = rails.size();
+        for (size_t i = 0; i < n; ++i) {
+            order[i] = i;
+        }
+        std::sort(order, order + n, [this](size_t a, size_t b) {
+            return rails[a]->outstanding_bytes < rails[b]->outstanding_bytes;
+        });
+
+        // Fill the k least loaded rails up to the same level
+        size_t k = std::clamp<size_t>(size / kRailStripeMin, 1, n);
+        size_t level = 0;
+        for (; k > 0; --k) {
+            size_t total = size;
+            for (size_t j = 0; j < k; ++j) {
+                total += rails[order[j]]->outstanding_bytes;
+            }
+            level = total / k;
+            if (k == 1 ||
+                level >= rails[order[k - 1]]->outstanding_bytes +
+                             kRailStripeMin) {
+                break;
+            }
+        }
+
+        size_t offset = 0;
+        for (size_t j = 0; j < k; ++j) {
+            size_t share = j + 1 < k
+                               ? level - rails[order[j]]->outstanding_bytes
+                               : size - offset;
+            out[j] = {order[j], offset, share};
+            offset += share;
+        }
+        return k;
+    }
+
+    //! \brief Waits for room for one more work request on a rail.
+    void reserve(size_t i) {
+        while (rails[i]->outstanding_wrs >= rails[i]->depth) {
+            poll();
+        }
+    }
+
+    std::vector<std::unique_ptr<rdma_context>> contexts;
+    // Indexed by device
+    std::vector<rdma_qp_config> configs;
+    std::vector<std::unique_ptr<rail>> rails;
+};
+
+//! \brief What a peer needs to access an `rdma_rail_region` through any
+//! rail, to be exchanged out of band like `rdma_qp::info`.
+struct rdma_rail_remote {
+    uint64_t addr;
+    uint64_t size;
+    //! Remote key of each rail, indexed by rail
+    std::vector<uint32_t> rkeys;
+
+    rdma_remote_memory_slice slice(size_t rail, size_t offset,
+                                   size_t size) const {
+        RDMALIB2_ASSERT(offset + size <= this->size);
+        return {addr + offset, size, rkeys[rail]};
+    }
+};
+
+//! \brief Memory registered with every device of a rail set, so that any
+//! rail can carry a part of it.
+class rdma_rail_region {
+public:
+    rdma_rail_region(rdma_rails const &rails, void *ptr, size_t size)
+        : rails(rails), addr(reinterpret_cast<uint64_t>(ptr)), size(size) {
+        regions.reserve(rails.get_num_devices());
+        for (size_t d = 0; d < rails.get_num_devices(); ++d) {
+            regions.emplace_back(rails.get_device_context(d), ptr, size);
+        }
+    }
+
+    rdma_rail_region(rdma_rail_region const &) = delete;
+    rdma_rail_region &operator=(rdma_rail_region const &) = delete;
+
+    rdma_rail_region(rdma_rail_region &&) = default;
+    rdma_rail_region &operator=(rdma_rail_region &&) = delete;
+
+    ~rdma_rail_region() = default;
+
+    size_t get_size() const { return size; }
+
+    //! \brief Gets the region registered with the device of a rail.
+    rdma_memory_region const &get_region(size_t rail) const {
+        return regions[rails.get_device(rail)];
+    }
+
+    rdma_memory_slice slice(size_t rail, size_t offset, size_t size) const {
+        return get_region(rail).slice(offset, size);
+    }
+
+    rdma_rail_remote get_remote() const {
+        rdma_rail_remote ret{addr, size, {}};
+        ret.rkeys.reserve(rails.size());
+        for (size_t i = 0; i < rails.size(); ++i) {
+            ret.rkeys.push_back(get_region(i).get_rkey());
+        }
+        return ret;
+    }
+
+protected:
+    rdma_rails const &rails;
+    uint64_t addr;
+    size_t size;
+    // Indexed by device
+    std::vector<rdma_memory_region> regions;
+};
+
+//! \brief A connection to one peer over every rail of a rail set, one RC QP
+//! per rail, which stripes large reads and writes across the rails.
+//!
+//! Both sides must list their rails in the same order: rail `i` connects to
+//! the peer's rail `i`. Transfers of at least `kRailStripeMin` bytes per
+//! rail are split over the rails with the fewest bytes in flight, each
+//! stripe being posted as signaled work requests of at most the port's
+//! maximum message size; smaller transfers go to the least loaded rail as a
+//! whole. Stripes on different rails complete in no particular order, and
+//! only the transfer handle tells when all are done.
+class rdma_rail_peer {
+public:
+    rdma_rail_peer(rdma_rails &rails) : rails(rails) {
+        qps.reserve(rails.size());
+        for (size_t i = 0; i < rails.size(); ++i) {
+            qps.emplace_back(rails.get_context(i), rails.get_cq(i),
+                             rails.get_cq(i), rails.get_config(i));
+            qps.back().bind_port(rails.get_port(i));
+        }
+    }
+
+    // Completions are credited through the rail set
+    rdma_rail_peer(rdma_rail_peer const &) = delete;
+    rdma_rail_peer &operator=(rdma_rail_peer const &) = delete;
+
+    rdma_rail_peer(rdma_rail_peer &&) = default;
+    rdma_rail_peer &operator=(rdma_rail_peer &&) = delete;
+
+    ~rdma_rail_peer() = default;
+
+    rdma_rc_qp &get_qp(size_t rail) { return qps[rail]; }
+
+    //! \brief Gets the QP info of every rail, in rail order.
+    std::vector<rdma_qp_info> get_info() const {
+        std::vector<rdma_qp_info> ret;
+        ret.reserve(qps.size());
+        for (auto const &qp : qps) {
+            ret.push_back(qp.get_info());
+        }
+        return ret;
+    }
+
+    rdma_rail_peer &connect(std::vector<rdma_qp_info> const &remote) {
+        RDMALIB2_ASSERT(remote.size() == qps.size());
+        for (size_t i = 0; i < qps.size(); ++i) {
+            qps[i].connect(remote[i], rails.get_port(i));
+        }
+        return *this;
+    }
+
+    //! \brief Reads `size` bytes of remote memory into local memory, striped
+    //! across the rails. `t` is done once all of them have arrived.
+    void read(rdma_rail_transfer &t, rdma_rail_region const &local,
+              size_t local_offset, rdma_rail_remote const &remote,
+              size_t remote_offset, size_t size) {
+        post<rdma_read>(t, local, local_offset, remote, remote_offset, size);
+    }
+
+    //! \brief Writes `size` bytes of local memory to remote memory, striped
+    //! across the rails. `t` is done once all of them have landed.
+    void write(rdma_rail_transfer &t, rdma_rail_region const &local,
+               size_t local_offset, rdma_rail_remote const &remote,
+               size_t remote_offset, size_t size) {
+        post<rdma_write>(t, local, local_offset, remote, remote_offset, size);
+    }
+
+protected:
+    template <typename Verb>
+    void post(rdma_rail_transfer &t, rdma_rail_region const &local,
+              size_t local_offset, rdma_rail_remote const &remote,
+              size_t remote_offset, size_t size) {
+        RDMALIB2_ASSERT(t.is_done() && size > 0);
+        rdma_rails::stripe stripes[kMaxRails];
+        size_t n = rails.plan(size, stripes);
+
+        // Stripes beyond the port's maximum message size take several work
+        // requests, all of which are counted before the first is posted
+        std::fill(std::begin(t.stripe_sizes), std::end(t.stripe_sizes), 0);
+        std::fill(std::begin(t.stripe_wrs), std::end(t.stripe_wrs), 0);
+        t.num_stripes = static_cast<uint32_t>(n);
+        t.pending = 0;
+        for (size_t j = 0; j < n; ++j) {
+            auto const &[i, offset, len] = stripes[j];
+            size_t max_msg_size = rails.rails[i]->max_msg_size;
+            t.stripe_sizes[i] = len;
+            t.stripe_wrs[i] = static_cast<uint32_t>(
+                (len + max_msg_size - 1) / max_msg_size);
+            t.pending += t.stripe_wrs[i];
+        }
+
+        for (size_t j = 0; j < n; ++j) {
+            auto const &[i, offset, len] = stripes[j];
+            auto &r = *rails.rails[i];
+            r.outstanding_bytes += len;
+            for (size_t done = 0; done < len; done += r.max_msg_size) {
+                size_t piece = std::min(len - done, r.max_msg_size);
+                rails.reserve(i);
+                Verb verb{local.slice(i, local_offset + offset + done, piece)};
+                verb.set_remote_memory(remote.slice(
+                        i, remote_offset + offset + done, piece))
+                    .set_id(reinterpret_cast<uint64_t>(&t))
+                    .set_notify(true);
+                qps[i].post_verb(verb);
+                ++r.outstanding_wrs;
+            }
+        }
+    }
+
+    rdma_rails &rails;
+    std::vector<rdma_rc_qp> qps;
+};
+
+} // namespace rdmalib2
+
+#endif // __RDMALIB2_RAILS_H__
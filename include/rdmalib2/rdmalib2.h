@@ -3,11 +3,26 @@
 #ifndef __RDMALIB2_H__
 #define __RDMALIB2_H__
 
+#include "ah_cache.h"
+#include "batch.h"
 #include "context.h"
+#include "coro.h"
 #include "cq.h"
+#include "dc.h"
+#include "demux.h"
+#include "flow.h"
 #include "mem.h"
+#include "pool.h"
 #include "qp.h"
+#include "qp_config.h"
+#include "rails.h"
+#include "recv_ring.h"
+#include "router.h"
+#include "srq.h"
+#include "submit.h"
+#include "striding_rq.h"
 #include "verb.h"
+#include "xrc.h"
 
 #include "cm.h"
 
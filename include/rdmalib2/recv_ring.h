@@ -0,0 +1,221 @@
+#pragma once
+
+#ifndef __RDMALIB2_RECV_RING_H__
+#define __RDMALIB2_RECV_RING_H__
+
+#include "cq.h"
+#include "mem.h"
+#include "qp.h"
+#include "srq.h"
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace rdmalib2 {
+
+//! \brief A ring of fixed-size receive buffers carved out of a memory region,
+//! which keeps a receive queue or a shared receive queue replenished.
+//!
+//! Slot `i` covers `[i * slot_size, (i + 1) * slot_size)` of the region and is
+//! always posted with wr_id `wr_id_base + i`, so receive completions map back
+//! to their slots without any lookup. Once the caller is done with a slot, it
+//! releases the slot, and released slots are re-posted in doorbell batches of
+//! `batch_size`. All bookkeeping is allocated at construction; the receive
+//! path itself never allocates.
+//!
+//! On UD QPs, the device writes a 40-byte GRH in front of every message, so
+//! the ring strips it off in `get_message()`. The GRH counts towards the
+//! slot size.
+class rdma_recv_ring {
+public:
+    rdma_recv_ring(rdma_memory_region const &region, size_t slot_size,
+                   size_t num_slots = 0, size_t batch_size = kRecvRingBatch,
+                   uint64_t wr_id_base = 0)
+        : region(region),
+          slot_size(slot_size),
+          num_slots(num_slots ? num_slots : region.get_size() / slot_size),
+          batch_size(batch_size),
+          wr_id_base(wr_id_base),
+          wrs(this->num_slots),
+          sges(this->num_slots),
+          released(this->num_slots) {
+        RDMALIB2_ASSERT(slot_size > 0 &&
+                        slot_size <= std::numeric_limits<uint32_t>::max());
+        RDMALIB2_ASSERT(this->num_slots > 0);
+        RDMALIB2_ASSERT(this->num_slots * slot_size <= region.get_size());
+        // Otherwise released slots never add up to a batch
+        RDMALIB2_ASSERT(batch_size > 0 && batch_size <= this->num_slots);
+
+        for (size_t i = 0; i < this->num_slots; ++i) {
+            sges[i] = {.addr = reinterpret_cast<uint64_t>(get_slot_ptr(i)),
+                       .length = static_cast<uint32_t>(slot_size),
+                       .lkey = region.get_lkey()};
+            wrs[i] = {};
+            wrs[i].wr_id = wr_id_base + i;
+            wrs[i].sg_list = &sges[i];
+            wrs[i].num_sge = 1;
+        }
+    }
+
+    // Work requests point into the ring itself
+    rdma_recv_ring(rdma_recv_ring const &) = delete;
+    rdma_recv_ring &operator=(rdma_recv_ring const &) = delete;
+
+    rdma_recv_ring(rdma_recv_ring &&) = delete;
+    rdma_recv_ring &operator=(rdma_recv_ring &&) = delete;
+
+    ~rdma_recv_ring() = default;
+
+    //! \brief Binds the ring to a QP with a private receive queue and posts
+    //! every slot.
+    template <ibv_qp_type Type>
+    rdma_recv_ring &attach(rdma_qp<Type> const &qp) {
+        RDMALIB2_ASSERT(!qp.get_srq());
+        RDMALIB2_ASSERT(!this->qp && !this->srq);
+        RDMALIB2_ASSERT(num_slots <= qp.get_config().depth);
+        this->qp = qp.get_qp();
+        if constexpr (Type == IBV_QPT_UD) {
+            set_header_size(sizeof(ibv_grh));
+        }
+        post_all();
+        return *this;
+    }
+
+    //! \brief Binds the ring to a shared receive queue and posts every slot.
+    //! Set `grh` if the SRQ serves UD QPs.
+    rdma_recv_ring &attach(rdma_srq const &srq, bool grh = false) {
+        RDMALIB2_ASSERT(!this->qp && !this->srq);
+        RDMALIB2_ASSERT(num_slots <= static_cast<size_t>(srq.get_depth()));
+        this->srq = srq.get_srq();
+        if (grh) {
+            set_header_size(sizeof(ibv_grh));
+        }
+        post_all();
+        return *this;
+    }
+
+    size_t get_slot_size() const { return slot_size; }
+    size_t get_num_slots() const { return num_slots; }
+
+    //! \brief Gets the number of released slots waiting to be re-posted.
+    size_t get_num_released() const { return num_released; }
+
+    //! \brief Checks whether a receive completion belongs to this ring.
+    bool owns(uint64_t wr_id) const { return wr_id - wr_id_base < num_slots; }
+
+    //! \brief Maps a receive completion's wr_id back to its slot index.
+    size_t slot_of(uint64_t wr_id) const { return wr_id - wr_id_base; }
+
+    void *get_slot_ptr(size_t idx) const {
+        return add_void_ptr(region.get_ptr(), idx * slot_size);
+    }
+
+    rdma_memory_slice get_slot(size_t idx) const {
+        return region.slice(idx * slot_size, slot_size);
+    }
+
+    //! \brief Gets the received message of a receive completion, without
+    //! the GRH on UD QPs.
+    rdma_memory_slice get_message(rdma_success_cqe const &cqe) const {
+        RDMALIB2_ASSERT(cqe.length >= header_size);
+        return region.slice(slot_of(cqe.wr_id) * slot_size + header_size,
+                            cqe.length - header_size);
+    }
+
+    //! \brief Gets the GRH in front of a UD message.
+    ibv_grh const *get_grh(rdma_success_cqe const &cqe) const {
+        RDMALIB2_ASSERT(header_size == sizeof(ibv_grh));
+        return static_cast<ibv_grh const *>(get_slot_ptr(slot_of(cqe.wr_id)));
+    }
+
+    //! \brief Gives a consumed slot back to the ring, re-posting all released
+    //! slots once a full batch has accumulated.
+    rdma_recv_ring &release(uint64_t wr_id) {
+        RDMALIB2_ASSERT(owns(wr_id));
+        released[(released_head + num_released) % num_slots] =
+            static_cast<uint32_t>(slot_of(wr_id));
+        if (++num_released >= batch_size) {
+            flush();
+        }
+        return *this;
+    }
+
+    //! \brief Re-posts all released slots with a single doorbell.
+    rdma_recv_ring &flush() {
+        if (num_released == 0) {
+            return *this;
+        }
+
+        // Chain the released slots together
+        ibv_recv_wr *head = &wrs[released[released_head]];
+        ibv_recv_wr *prev = head;
+        for (size_t i = 1; i < num_released; ++i) {
+            ibv_recv_wr *wr = &wrs[released[(released_head + i) % num_slots]];
+            prev->next = wr;
+            prev = wr;
+        }
+        prev->next = nullptr;
+
+        post(head);
+        released_head = (released_head + num_released) % num_slots;
+        num_released = 0;
+        return *this;
+    }
+
+protected:
+    void set_header_size(size_t size) {
+        RDMALIB2_ASSERT(slot_size > size);
+        header_size = size;
+    }
+
+    //! \brief Posts every slot, `batch_size` per doorbell.
+    void post_all() {
+        for (size_t first = 0; first < num_slots; first += batch_size) {
+            size_t last = std::min(first + batch_size, num_slots);
+            for (size_t i = first; i < last; ++i) {
+                wrs[i].next = i + 1 < last ? &wrs[i + 1] : nullptr;
+            }
+            post(&wrs[first]);
+        }
+    }
+
+    void post(ibv_recv_wr *head) {
+        int ret = 0;
+        ibv_recv_wr *bad_wr = nullptr;
+        if (srq) {
+            ret = ibv_post_srq_recv(srq, head, &bad_wr);
+        } else {
+            RDMALIB2_ASSERT(qp);
+            ret = ibv_post_recv(qp, head, &bad_wr);
+        }
+
+        if (unlikely(ret)) {
+            spdlog::error("post recv ring failed with return value {}", ret);
+            panic_with_errno();
+        }
+    }
+
+    rdma_memory_region const &region;
+    size_t slot_size;
+    size_t num_slots;
+    size_t batch_size;
+    uint64_t wr_id_base;
+
+    // Bytes the device writes in front of every message
+    size_t header_size = 0;
+
+    ibv_qp *qp = nullptr;
+    ibv_srq *srq = nullptr;
+
+    std::vector<ibv_recv_wr> wrs;
+    std::vector<ibv_sge> sges;
+
+    // Released slot indices waiting to be re-posted, as a circular buffer
+    std::vector<uint32_t> released;
+    size_t released_head = 0;
+    size_t num_released = 0;
+};
+
+} // namespace rdmalib2
+
+#endif // __RDMALIB2_RECV_RING_H__
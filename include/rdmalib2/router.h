@@ -0,0 +1,249 @@
+#pragma once
+
+#ifndef __RDMALIB2_ROUTER_H__
+#define __RDMALIB2_ROUTER_H__
+
+#include "cq.h"
+#include "qp.h"
+#include "verb.h"
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+
+namespace rdmalib2 {
+
+//! \brief Dispatches completions to per-operation continuations keyed by
+//! wr_id.
+//!
+//! Registering a continuation takes a slot from a preallocated table and
+//! returns the wr_id to post the verb with; polling through the router
+//! invokes the continuation of every completion and frees its slot. The
+//! wr_id encodes the slot index together with the slot's generation, so a
+//! stale or duplicate completion is detected instead of running someone
+//! else's continuation.
+//!
+//! Free slots form a lock-free stack, so any thread may register
+//! continuations while one thread polls. Continuations are stored inline and
+//! must be trivially copyable and at most `kRouterContinuationSize` bytes,
+//! e.g., lambdas capturing a couple of pointers; nothing is ever allocated
+//! after construction.
+class rdma_completion_router {
+    //! All router wr_ids carry this bit, so they never collide with plain
+    //! small integer wr_ids. Bit 63 is left to send queue trackers.
+    static constexpr uint64_t wr_id_tag = 1ull << 62;
+    static constexpr uint32_t gen_mask = (1u << 30) - 1;
+    static constexpr uint32_t nil = ~0u;
+
+public:
+    explicit rdma_completion_router(uint32_t capacity)
+        : capacity(capacity), slots(std::make_unique<slot[]>(capacity)) {
+        RDMALIB2_ASSERT(capacity > 0 && capacity < nil);
+        for (uint32_t i = 0; i < capacity; ++i) {
+            slots[i].next.store(i + 1 < capacity ? i + 1 : nil,
+                                std::memory_order_relaxed);
+        }
+        free_head.store(pack_head(0, 0), std::memory_order_relaxed);
+    }
+
+    // Posted wr_ids refer to slots of this router
+    rdma_completion_router(rdma_completion_router const &) = delete;
+    rdma_completion_router &operator=(rdma_completion_router const &) = delete;
+
+    rdma_completion_router(rdma_completion_router &&) = delete;
+    rdma_completion_router &operator=(rdma_completion_router &&) = delete;
+
+    ~rdma_completion_router() = default;
+
+    uint32_t get_capacity() const { return capacity; }
+
+    //! \brief Checks whether a wr_id was handed out by a router.
+    static bool is_routed(uint64_t wr_id) { return wr_id & wr_id_tag; }
+
+    //! \brief Registers a continuation invoked with the `rdma_success_cqe`
+    //! of the operation.
+    //!
+    //! \return The wr_id to post the operation with, or `std::nullopt` if all
+    //! slots are in use.
+    template <typename F>
+        requires std::invocable<F &, rdma_success_cqe const &>
+    std::optional<uint64_t> try_add(F &&continuation) {
+        using Fn = std::remove_cvref_t<F>;
+        static_assert(sizeof(Fn) <= kRouterContinuationSize,
+                      "continuation too large to be stored inline");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t),
+                      "continuation over-aligned");
+        static_assert(std::is_trivially_copyable_v<Fn> &&
+                          std::is_trivially_destructible_v<Fn>,
+                      "continuation must be trivially copyable");
+
+        uint32_t idx = pop_free();
+        if (idx == nil) {
+            return std::nullopt;
+        }
+
+        slot &s = slots[idx];
+        new (s.storage) Fn(std::forward<F>(continuation));
+        s.invoke = [](void *storage, rdma_success_cqe const &cqe) {
+            (*std::launder(reinterpret_cast<Fn *>(storage)))(cqe);
+        };
+        uint32_t gen = s.gen.load(std::memory_order_relaxed);
+        return std::make_optional(wr_id_tag |
+                                  (static_cast<uint64_t>(gen) << 32) | idx);
+    }
+
+    //! \brief Registers a continuation, panicking if all slots are in use.
+    template <typename F>
+        requires std::invocable<F &, rdma_success_cqe const &>
+    uint64_t add(F &&continuation) {
+        auto wr_id = try_add(std::forward<F>(continuation));
+        if (unlikely(!wr_id.has_value())) {
+            spdlog::error("completion router {:p} is out of its {} slot(s)",
+                          reinterpret_cast<void *>(this), capacity);
+            panic();
+        }
+        return wr_id.value();
+    }
+
+    //! \brief Registers a continuation and posts a signaled verb that
+    //! completes into it.
+    template <typename Tag, uint32_t MaxSge, ibv_qp_type Type, typename F>
+        requires std::invocable<F &, rdma_success_cqe const &>
+    void post(rdma_qp<Type> const &qp, rdma_verb<Tag, MaxSge> &verb,
+              F &&continuation) {
+        verb.set_id(add(std::forward<F>(continuation)));
+        if constexpr (!std::is_same_v<typename rdma_verb<Tag, MaxSge>::wr_type,
+                                      ibv_recv_wr>) {
+            verb.set_notify(true);
+        }
+        qp.post_verb(verb);
+    }
+
+    //! \brief Frees the slot of a registered wr_id without invoking its
+    //! continuation, e.g., when the operation was never posted.
+    void cancel(uint64_t wr_id) {
+        RDMALIB2_ASSERT(is_current(wr_id));
+        push_free(static_cast<uint32_t>(wr_id));
+    }
+
+    //! \brief Invokes and frees the continuation of a routed completion.
+    //!
+    //! \return False if the wr_id is not routed, true otherwise.
+    bool dispatch(rdma_success_cqe const &cqe) {
+        if (!is_routed(cqe.wr_id)) {
+            return false;
+        }
+        if (unlikely(!is_current(cqe.wr_id))) {
+            spdlog::error("completion router {:p} got stale wr_id {:#x}",
+                          reinterpret_cast<void *>(this), cqe.wr_id);
+            panic();
+        }
+
+        // Free the slot first, so the continuation may register a new one
+        uint32_t idx = static_cast<uint32_t>(cqe.wr_id);
+        slot &s = slots[idx];
+        alignas(std::max_align_t)
+            unsigned char storage[kRouterContinuationSize];
+        std::memcpy(storage, s.storage, sizeof(storage));
+        auto invoke = s.invoke;
+        push_free(idx);
+
+        invoke(storage, cqe);
+        return true;
+    }
+
+    //! \brief Polls at most `num_entries` completions from `cq` without
+    //! waiting, dispatching routed ones and passing the others to
+    //! `unrouted`.
+    //!
+    //! \return The number of completions harvested.
+    template <typename F>
+        requires std::invocable<F &, rdma_success_cqe const &>
+    int poll(rdma_cq const &cq, F &&unrouted, int num_entries = kMaxPollCq) {
+        return cq.try_poll_with_wc(
+            [&](rdma_success_cqe const &cqe) {
+                if (!dispatch(cqe)) {
+                    unrouted(cqe);
+                }
+            },
+            num_entries);
+    }
+
+    //! \brief Polls at most `num_entries` completions from `cq` without
+    //! waiting; every one of them must be routed.
+    //!
+    //! \return The number of completions harvested.
+    int poll(rdma_cq const &cq, int num_entries = kMaxPollCq) {
+        return poll(
+            cq,
+            [this](rdma_success_cqe const &cqe) {
+                spdlog::error("completion router {:p} got unrouted wr_id {}",
+                              reinterpret_cast<void *>(this), cqe.wr_id);
+                panic();
+            },
+            num_entries);
+    }
+
+protected:
+    struct slot {
+        alignas(std::max_align_t)
+            unsigned char storage[kRouterContinuationSize];
+        void (*invoke)(void *, rdma_success_cqe const &) = nullptr;
+        std::atomic<uint32_t> gen{0};
+        std::atomic<uint32_t> next{nil};
+    };
+
+    // The free list head packs a version counter against ABA with the index
+    static constexpr uint64_t pack_head(uint32_t version, uint32_t idx) {
+        return (static_cast<uint64_t>(version) << 32) | idx;
+    }
+
+    bool is_current(uint64_t wr_id) const {
+        uint32_t idx = static_cast<uint32_t>(wr_id);
+        uint32_t gen = static_cast<uint32_t>(wr_id >> 32) & gen_mask;
+        return idx < capacity &&
+               slots[idx].gen.load(std::memory_order_relaxed) == gen;
+    }
+
+    uint32_t pop_free() {
+        uint64_t head = free_head.load(std::memory_order_acquire);
+        while (true) {
+            uint32_t idx = static_cast<uint32_t>(head);
+            if (idx == nil) {
+                return nil;
+            }
+            uint32_t next = slots[idx].next.load(std::memory_order_relaxed);
+            if (free_head.compare_exchange_weak(
+                    head, pack_head((head >> 32) + 1, next),
+                    std::memory_order_acquire, std::memory_order_acquire)) {
+                return idx;
+            }
+        }
+    }
+
+    void push_free(uint32_t idx) {
+        slot &s = slots[idx];
+        s.gen.store((s.gen.load(std::memory_order_relaxed) + 1) & gen_mask,
+                    std::memory_order_relaxed);
+
+        uint64_t head = free_head.load(std::memory_order_relaxed);
+        do {
+            s.next.store(static_cast<uint32_t>(head),
+                         std::memory_order_relaxed);
+        } while (!free_head.compare_exchange_weak(
+            head, pack_head((head >> 32) + 1, idx), std::memory_order_release,
+            std::memory_order_relaxed));
+    }
+
+    uint32_t capacity;
+    std::unique_ptr<slot[]> slots;
+    std::atomic<uint64_t> free_head;
+};
+
+} // namespace rdmalib2
+
+#endif // __RDMALIB2_ROUTER_H__
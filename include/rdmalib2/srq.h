@@ -0,0 +1,216 @@
+#pragma once
+
+#ifndef __RDMALIB2_SRQ_H__
+#define __RDMALIB2_SRQ_H__
+
+#include "context.h"
+#include "cq.h"
+#include "predeclare/verb_pre.h"
+#include "xrc.h"
+#include <iterator>
+#include <new>
+#include <optional>
+#include <type_traits>
+
+namespace rdmalib2 {
+
+//! \brief A shared receive queue, from which any number of QPs consume
+//! receive work requests.
+//!
+//! Receive memory then scales with the load rather than with the number of
+//! connections. To replenish the pool before it runs dry, arm the SRQ limit
+//! with `arm_limit()`: once fewer receive work requests than the limit remain,
+//! the device raises an `IBV_EVENT_SRQ_LIMIT_REACHED` asynchronous event,
+//! which can be fetched with `rdma_context::get_async_event()` and matched
+//! with `is_limit_event()`. The limit is disarmed when the event fires.
+class rdma_srq {
+public:
+    rdma_srq(rdma_context const &ctx, int srq_depth = kQpDepth,
+             uint32_t srq_limit = 0)
+        : ctx(ctx), depth(srq_depth) {
+        auto srq = create_rdma_srq(ctx, srq_depth, srq_limit);
+        if (srq.has_value()) {
+            this->srq = srq.value();
+            spdlog::trace("created shared receive queue {:p} with depth {}, "
+                          "limit {} for context {:p}",
+                          reinterpret_cast<void *>(this->srq), srq_depth,
+                          srq_limit,
+                          reinterpret_cast<void const *>(ctx.get_context()));
+        } else {
+            spdlog::error("failed to create shared receive queue with depth "
+                          "{} for context {:p}",
+                          srq_depth,
+                          reinterpret_cast<void const *>(ctx.get_context()));
+            panic_with_errno();
+        }
+    }
+
+    //! \brief Creates an XRC SRQ in `xrcd`, which XRC send QPs of other nodes
+    //! address by `get_srq_num()`. Its receive completions go to `cq`.
+    rdma_srq(rdma_context const &ctx, rdma_xrcd const &xrcd,
+             rdma_cq const &cq, int srq_depth = kQpDepth,
+             uint32_t srq_limit = 0)
+        : ctx(ctx), depth(srq_depth) {
+        auto srq = create_rdma_xrc_srq(ctx, xrcd, cq, srq_depth, srq_limit);
+        if (srq.has_value()) {
+            this->srq = srq.value();
+            spdlog::trace("created XRC shared receive queue {:p} with depth "
+                          "{}, number {} in XRC domain {:p}",
+                          reinterpret_cast<void *>(this->srq), srq_depth,
+                          get_srq_num(),
+                          reinterpret_cast<void *>(xrcd.get_xrcd()));
+        } else {
+            spdlog::error("failed to create XRC shared receive queue with "
+                          "depth {} in XRC domain {:p}",
+                          srq_depth, reinterpret_cast<void *>(xrcd.get_xrcd()));
+            panic_with_errno();
+        }
+    }
+
+    rdma_srq(rdma_srq const &) = delete;
+    rdma_srq &operator=(rdma_srq const &) = delete;
+
+    rdma_srq(rdma_srq &&other) noexcept
+        : ctx(other.ctx), depth(other.depth), srq(other.srq) {
+        other.srq = nullptr;
+    }
+
+    rdma_srq &operator=(rdma_srq &&other) & noexcept {
+        if (this != &other) {
+            this->~rdma_srq();
+            new (this) rdma_srq(std::move(other));
+        }
+        return *this;
+    }
+
+    ~rdma_srq() {
+        if (srq) {
+            spdlog::trace("destroying shared receive queue {:p}",
+                          reinterpret_cast<void *>(srq));
+            ibv_destroy_srq(srq);
+            srq = nullptr;
+        }
+    }
+
+    ibv_srq *get_srq() const { return srq; }
+
+    //! \brief Gets the number of receive work requests the SRQ was created
+    //! to hold.
+    int get_depth() const { return depth; }
+
+    //! \brief Gets the number that XRC senders address this XRC SRQ by.
+    uint32_t get_srq_num() const {
+        uint32_t srq_num = 0;
+        if (ibv_get_srq_num(srq, &srq_num)) {
+            spdlog::error("failed to get number of shared receive queue {:p}",
+                          reinterpret_cast<void *>(srq));
+            panic_with_errno();
+        }
+        return srq_num;
+    }
+
+    //! \brief Arms the SRQ limit event, which fires once fewer than `limit`
+    //! receive work requests remain in the SRQ.
+    rdma_srq &arm_limit(uint32_t limit) {
+        ibv_srq_attr attr = {};
+        attr.srq_limit = limit;
+        if (ibv_modify_srq(srq, &attr, IBV_SRQ_LIMIT)) {
+            spdlog::error("failed to arm limit {} on shared receive queue {:p}",
+                          limit, reinterpret_cast<void *>(srq));
+            panic_with_errno();
+        }
+        return *this;
+    }
+
+    //! \brief Checks whether an asynchronous event is this SRQ's limit event.
+    bool is_limit_event(ibv_async_event const &event) const {
+        return event.event_type == IBV_EVENT_SRQ_LIMIT_REACHED &&
+               event.element.srq == srq;
+    }
+
+    template <typename Wr, uint32_t MaxSge>
+    void post_verb(rdma_verb<Wr, MaxSge> &verb) const {
+        static_assert(std::is_same_v<Wr, ibv_recv_wr>,
+                      "only recv verbs can be posted to a shared receive queue");
+        ibv_recv_wr *bad_wr = nullptr;
+        int ret = ibv_post_srq_recv(
+            srq, const_cast<ibv_recv_wr *>(&verb.get_wr()), &bad_wr);
+        if (unlikely(ret)) {
+            spdlog::error("post srq recv failed with return value {}", ret);
+            panic_with_errno();
+        }
+    }
+
+    template <typename ForwardIt>
+    void post_verb(ForwardIt first, ForwardIt last) const {
+        using Wr =
+            typename std::remove_cv_t<std::decay_t<decltype(*first)>>::wr_type;
+        static_assert(std::is_same_v<Wr, ibv_recv_wr>,
+                      "only recv verbs can be posted to a shared receive queue");
+        if (first == last) {
+            return;
+        }
+
+        // Temporarily chain the work requests together
+        ibv_recv_wr *head = const_cast<ibv_recv_wr *>(&(*first).get_wr());
+        for (ForwardIt it = first; it != last; ++it) {
+            auto next = std::next(it);
+            if (next != last) {
+                (*it).set_next(*next);
+            } else {
+                (*it).clear_next();
+            }
+        }
+
+        ibv_recv_wr *bad_wr = nullptr;
+        int ret = ibv_post_srq_recv(srq, head, &bad_wr);
+        if (unlikely(ret)) {
+            spdlog::error("post srq recv failed with return value {}", ret);
+            panic_with_errno();
+        }
+
+        // Cleanup
+        for (ForwardIt it = first; it != last; ++it) {
+            (*it).clear_next();
+        }
+    }
+
+protected:
+    static std::optional<ibv_srq *>
+    create_rdma_srq(rdma_context const &ctx, int srq_depth,
+                    uint32_t srq_limit) {
+        ibv_srq_init_attr init_attr = {};
+        init_attr.attr.max_wr = srq_depth;
+        init_attr.attr.max_sge = kMaxSge;
+        init_attr.attr.srq_limit = srq_limit;
+
+        ibv_srq *srq = ibv_create_srq(ctx.get_pd(), &init_attr);
+        return srq ? std::make_optional(srq) : std::nullopt;
+    }
+
+    static std::optional<ibv_srq *>
+    create_rdma_xrc_srq(rdma_context const &ctx, rdma_xrcd const &xrcd,
+                        rdma_cq const &cq, int srq_depth, uint32_t srq_limit) {
+        ibv_srq_init_attr_ex init_attr = {};
+        init_attr.attr.max_wr = srq_depth;
+        init_attr.attr.max_sge = kMaxSge;
+        init_attr.attr.srq_limit = srq_limit;
+        init_attr.comp_mask = IBV_SRQ_INIT_ATTR_TYPE | IBV_SRQ_INIT_ATTR_PD |
+                              IBV_SRQ_INIT_ATTR_XRCD | IBV_SRQ_INIT_ATTR_CQ;
+        init_attr.srq_type = IBV_SRQT_XRC;
+        init_attr.pd = ctx.get_pd();
+        init_attr.xrcd = xrcd.get_xrcd();
+        init_attr.cq = cq.get_cq();
+
+        ibv_srq *srq = ibv_create_srq_ex(ctx.get_context(), &init_attr);
+        return srq ? std::make_optional(srq) : std::nullopt;
+    }
+
+    rdma_context const &ctx;
+    int depth;
+    ibv_srq *srq = nullptr;
+};
+
+} // namespace rdmalib2
+
+#endif // __RDMALIB2_SRQ_H__
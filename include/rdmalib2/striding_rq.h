@@ -0,0 +1,306 @@
+#pragma once
+
+#ifndef __RDMALIB2_STRIDING_RQ_H__
+#define __RDMALIB2_STRIDING_RQ_H__
+
+#include "context.h"
+#include "cq.h"
+#include "mem.h"
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+namespace rdmalib2 {
+
+//! \brief A message received into a striding receive queue.
+struct rdma_stride_msg {
+    //! Index of the receive buffer that holds the message
+    uint32_t buffer;
+    //! Offset of the message inside the buffer, in strides
+    uint32_t stride;
+    uint32_t length;
+    void *ptr;
+};
+
+//! \brief A multi-packet (striding) receive queue, where each posted buffer
+//! holds many messages in consecutive strides.
+//!
+//! MLNX OFED 4 only supports multi-packet receive queues through experimental
+//! work queues, so this class owns a striding work queue, a single-entry
+//! indirection table and a receive-only raw packet QP hashing into it. Steer
+//! traffic to `get_qp()` with flow rules.
+//!
+//! The memory region is carved into buffers of `1 << log_num_strides` strides
+//! of `1 << log_stride_size` bytes each, and all of them are posted up front.
+//! The completion queue must be dedicated to this receive queue: it is polled
+//! through the accelerated CQ interface, which reports the stride offset of
+//! every message. A buffer is re-posted as soon as the device reports it fully
+//! consumed and the callback for its last message returns, so messages must
+//! be consumed within `poll()`'s callback.
+class rdma_striding_rq {
+public:
+    rdma_striding_rq(rdma_context const &ctx, rdma_cq const &cq,
+                     rdma_memory_region const &region, uint8_t log_stride_size,
+                     uint8_t log_num_strides, uint8_t port = 1)
+        : ctx(ctx),
+          cq(cq.get_cq()),
+          region(region),
+          log_stride_size(log_stride_size),
+          log_num_strides(log_num_strides),
+          num_buffers(region.get_size() >> (log_stride_size + log_num_strides)),
+          sges(num_buffers) {
+        RDMALIB2_ASSERT(num_buffers > 0);
+
+        size_t buffer_size = get_buffer_size();
+        for (size_t i = 0; i < num_buffers; ++i) {
+            sges[i] = {.addr = reinterpret_cast<uint64_t>(
+                           add_void_ptr(region.get_ptr(), i * buffer_size)),
+                       .length = static_cast<uint32_t>(buffer_size),
+                       .lkey = region.get_lkey()};
+        }
+
+        auto objs = create_rdma_striding_rq(ctx, this->cq, num_buffers,
+                                            log_stride_size, log_num_strides,
+                                            port);
+        if (objs.has_value()) {
+            std::tie(wq, ind_tbl, qp) = objs.value();
+            spdlog::trace("created striding receive queue {:p} with {} "
+                          "buffer(s) of {} {}-byte stride(s) on port {}",
+                          reinterpret_cast<void *>(wq), num_buffers,
+                          1u << log_num_strides, 1u << log_stride_size, port);
+        } else {
+            spdlog::error("failed to create striding receive queue with {} "
+                          "buffer(s) for context {:p}",
+                          num_buffers,
+                          reinterpret_cast<void const *>(ctx.get_context()));
+            panic_with_errno();
+        }
+
+        wq_family = query_intf<ibv_exp_wq_family>(IBV_EXP_INTF_WQ, 0, wq);
+        cq_family = query_intf<ibv_exp_cq_family_v1>(IBV_EXP_INTF_CQ, 1,
+                                                      this->cq);
+        post(0, num_buffers);
+    }
+
+    // Scatter-gather entries are owned by the receive queue itself
+    rdma_striding_rq(rdma_striding_rq const &) = delete;
+    rdma_striding_rq &operator=(rdma_striding_rq const &) = delete;
+
+    rdma_striding_rq(rdma_striding_rq &&) = delete;
+    rdma_striding_rq &operator=(rdma_striding_rq &&) = delete;
+
+    ~rdma_striding_rq() {
+        ibv_exp_release_intf_params params = {};
+        if (cq_family) {
+            ibv_exp_release_intf(ctx.get_context(), cq_family, &params);
+            cq_family = nullptr;
+        }
+        if (wq_family) {
+            ibv_exp_release_intf(ctx.get_context(), wq_family, &params);
+            wq_family = nullptr;
+        }
+        if (qp) {
+            spdlog::trace("destroying striding receive queue {:p}",
+                          reinterpret_cast<void *>(wq));
+            ibv_destroy_qp(qp);
+            qp = nullptr;
+        }
+        if (ind_tbl) {
+            ibv_exp_destroy_rwq_ind_table(ind_tbl);
+            ind_tbl = nullptr;
+        }
+        if (wq) {
+            ibv_exp_destroy_wq(wq);
+            wq = nullptr;
+        }
+    }
+
+    ibv_qp *get_qp() const { return qp; }
+    ibv_exp_wq *get_wq() const { return wq; }
+
+    size_t get_stride_size() const { return size_t{1} << log_stride_size; }
+    size_t get_num_strides() const { return size_t{1} << log_num_strides; }
+    size_t get_buffer_size() const {
+        return size_t{1} << (log_stride_size + log_num_strides);
+    }
+    size_t get_num_buffers() const { return num_buffers; }
+
+    //! \brief Polls for at most `max_msgs` messages, calling `callback` with
+    //! an `rdma_stride_msg const &` for each of them, and re-posts every
+    //! buffer consumed meanwhile with a single doorbell.
+    //!
+    //! \return The number of messages received.
+    template <typename F> int poll(F &&callback, int max_msgs = kMaxPollCq) {
+        int ret = 0;
+        size_t consumed = 0;
+        while (ret < max_msgs) {
+            uint32_t offset = 0;
+            uint32_t flags = 0;
+            int32_t len =
+                cq_family->poll_length_flags_mp_rq(cq, &offset, &flags);
+            if (len < 0) {
+                spdlog::error("poll striding receive queue {:p} failed with "
+                              "return value {}",
+                              reinterpret_cast<void *>(wq), len);
+                panic_with_errno();
+            }
+
+            // Filler completions consume strides without carrying a message
+            if (len > 0) {
+                uint32_t buffer = (head + consumed) % num_buffers;
+                callback(rdma_stride_msg{
+                    .buffer = buffer,
+                    .stride = offset,
+                    .length = static_cast<uint32_t>(len),
+                    .ptr = reinterpret_cast<void *>(
+                        sges[buffer].addr +
+                        (static_cast<uint64_t>(offset) << log_stride_size)),
+                });
+                ++ret;
+            }
+            if (flags & IBV_EXP_CQ_RX_MULTI_PACKET_LAST_V1) {
+                ++consumed;
+            } else if (len == 0) {
+                break;
+            }
+        }
+
+        if (consumed > 0) {
+            post(head, consumed);
+            head = (head + consumed) % num_buffers;
+        }
+        return ret;
+    }
+
+protected:
+    static std::optional<
+        std::tuple<ibv_exp_wq *, ibv_exp_rwq_ind_table *, ibv_qp *>>
+    create_rdma_striding_rq(rdma_context const &ctx, ibv_cq *cq,
+                            size_t num_buffers, uint8_t log_stride_size,
+                            uint8_t log_num_strides, uint8_t port) {
+        ibv_exp_wq_init_attr wq_attr = {};
+        wq_attr.wq_type = IBV_EXP_WQT_RQ;
+        wq_attr.max_recv_wr = num_buffers;
+        wq_attr.max_recv_sge = 1;
+        wq_attr.pd = ctx.get_pd();
+        wq_attr.cq = cq;
+        wq_attr.comp_mask = IBV_EXP_CREATE_WQ_MP_RQ;
+        wq_attr.mp_rq.use_shift = IBV_EXP_MP_RQ_NO_SHIFT;
+        wq_attr.mp_rq.single_wqe_log_num_of_strides = log_num_strides;
+        wq_attr.mp_rq.single_stride_log_num_of_bytes = log_stride_size;
+        auto rd = ctx.get_res_domain();
+        if (rd.has_value()) {
+            wq_attr.comp_mask |= IBV_EXP_CREATE_WQ_RES_DOMAIN;
+            wq_attr.res_domain = rd.value();
+        }
+
+        ibv_exp_wq *wq = ibv_exp_create_wq(ctx.get_context(), &wq_attr);
+        if (!wq) {
+            return std::nullopt;
+        }
+
+        ibv_exp_wq_attr mod_attr = {};
+        mod_attr.attr_mask = IBV_EXP_WQ_ATTR_STATE;
+        mod_attr.wq_state = IBV_EXP_WQS_RDY;
+        if (ibv_exp_modify_wq(wq, &mod_attr)) {
+            ibv_exp_destroy_wq(wq);
+            return std::nullopt;
+        }
+
+        ibv_exp_rwq_ind_table_init_attr tbl_attr = {};
+        tbl_attr.pd = ctx.get_pd();
+        tbl_attr.log_ind_tbl_size = 0;
+        tbl_attr.ind_tbl = &wq;
+        ibv_exp_rwq_ind_table *ind_tbl =
+            ibv_exp_create_rwq_ind_table(ctx.get_context(), &tbl_attr);
+        if (!ind_tbl) {
+            ibv_exp_destroy_wq(wq);
+            return std::nullopt;
+        }
+
+        // With a single work queue, the hash only has to be well-formed
+        static uint8_t rss_key[40] = {};
+        ibv_exp_rx_hash_conf hash_conf = {};
+        hash_conf.rx_hash_function = IBV_EXP_RX_HASH_FUNC_TOEPLITZ;
+        hash_conf.rx_hash_key_len = sizeof(rss_key);
+        hash_conf.rx_hash_key = rss_key;
+        hash_conf.rx_hash_fields_mask = 0;
+        hash_conf.rwq_ind_tbl = ind_tbl;
+
+        ibv_exp_qp_init_attr qp_attr = {};
+        qp_attr.qp_type = IBV_QPT_RAW_PACKET;
+        qp_attr.comp_mask = IBV_EXP_QP_INIT_ATTR_PD |
+                            IBV_EXP_QP_INIT_ATTR_RX_HASH |
+                            IBV_EXP_QP_INIT_ATTR_PORT;
+        qp_attr.pd = ctx.get_pd();
+        qp_attr.rx_hash_conf = &hash_conf;
+        qp_attr.port_num = port;
+
+        ibv_qp *qp = ibv_exp_create_qp(ctx.get_context(), &qp_attr);
+        if (!qp) {
+            ibv_exp_destroy_rwq_ind_table(ind_tbl);
+            ibv_exp_destroy_wq(wq);
+            return std::nullopt;
+        }
+        return std::make_optional(std::make_tuple(wq, ind_tbl, qp));
+    }
+
+    template <typename Family>
+    Family *query_intf(ibv_exp_intf_family intf, uint32_t version, void *obj) {
+        ibv_exp_query_intf_params params = {};
+        params.intf_scope = IBV_EXP_INTF_GLOBAL;
+        params.intf = intf;
+        params.intf_version = version;
+        params.obj = obj;
+
+        ibv_exp_query_intf_status status = IBV_EXP_INTF_STAT_OK;
+        auto *family = static_cast<Family *>(
+            ibv_exp_query_intf(ctx.get_context(), &params, &status));
+        if (!family || status != IBV_EXP_INTF_STAT_OK) {
+            spdlog::error("failed to query interface family {} for striding "
+                          "receive queue {:p}: status {}",
+                          static_cast<int>(intf), reinterpret_cast<void *>(wq),
+                          static_cast<int>(status));
+            panic();
+        }
+        return family;
+    }
+
+    //! \brief Posts `n` buffers starting from buffer `first`, wrapping around.
+    void post(size_t first, size_t n) {
+        size_t contiguous = std::min(n, num_buffers - first);
+        int ret = wq_family->recv_burst(wq, &sges[first], contiguous);
+        if (ret == 0 && contiguous < n) {
+            ret = wq_family->recv_burst(wq, &sges[0], n - contiguous);
+        }
+        if (unlikely(ret)) {
+            spdlog::error("post striding receive queue {:p} failed with "
+                          "return value {}",
+                          reinterpret_cast<void *>(wq), ret);
+            panic_with_errno();
+        }
+    }
+
+    rdma_context const &ctx;
+    ibv_cq *cq;
+    rdma_memory_region const &region;
+    uint8_t log_stride_size;
+    uint8_t log_num_strides;
+    size_t num_buffers;
+
+    ibv_exp_wq *wq = nullptr;
+    ibv_exp_rwq_ind_table *ind_tbl = nullptr;
+    ibv_qp *qp = nullptr;
+    ibv_exp_wq_family *wq_family = nullptr;
+    ibv_exp_cq_family_v1 *cq_family = nullptr;
+
+    // Buffers are consumed and re-posted in order, starting from `head`
+    std::vector<ibv_sge> sges;
+    size_t head = 0;
+};
+
+} // namespace rdmalib2
+
+#endif // __RDMALIB2_STRIDING_RQ_H__
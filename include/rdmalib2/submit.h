@@ -0,0 +1,242 @@
+#pragma once
+
+#ifndef __RDMALIB2_SUBMIT_H__
+#define __RDMALIB2_SUBMIT_H__
+
+#include "batch.h"
+#include "cq.h"
+#include "qp.h"
+#include "router.h"
+#include "verb.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+namespace rdmalib2 {
+
+//! \brief A lock-free multi-producer, single-consumer submission ring in
+//! front of a QP.
+//!
+//! Any thread may submit send verbs, which are copied into the ring without
+//! taking a lock; the thread owning the QP drains the ring with `drain()`,
+//! posting up to `kSubmitBatch` verbs behind each doorbell. Compared to
+//! posting from every thread through a thread-safe context, this trades the
+//! latency of a hop through the owner for fewer doorbells and no contention
+//! on the provider's lock.
+//!
+//! Completions reach producers through continuations registered with the
+//! completion router, which the owner runs while polling the send CQ with
+//! `progress()`. Memory referenced by a verb, including payloads to be
+//! inlined, must stay valid until the owner has drained it, so unsignaled
+//! verbs should only reference memory that is never reused.
+//!
+//! The QP must have automatic selective signaling enabled, which retires
+//! unsignaled verbs and tracks the free send queue slots: `drain()` never
+//! posts more verbs than there are free slots and leaves the rest in the
+//! ring.
+template <ibv_qp_type Type, uint32_t MaxSge = 1> class rdma_submission_ring {
+    struct slot {
+        std::atomic<uint64_t> seq{0};
+        ibv_exp_send_wr wr;
+        ibv_sge sgl[MaxSge];
+        uint64_t wr_id;
+        bool notified;
+    };
+
+public:
+    rdma_submission_ring(rdma_qp<Type> const &qp,
+                         rdma_completion_router &router,
+                         size_t capacity = kSubmitRingSize)
+        : qp(qp),
+          router(router),
+          mask(capacity - 1),
+          slots(std::make_unique<slot[]>(capacity)) {
+        RDMALIB2_ASSERT(capacity > 0 && (capacity & mask) == 0);
+        RDMALIB2_ASSERT(qp.get_sq_tracker());
+        for (size_t i = 0; i < capacity; ++i) {
+            slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Producers refer to the ring
+    rdma_submission_ring(rdma_submission_ring const &) = delete;
+    rdma_submission_ring &operator=(rdma_submission_ring const &) = delete;
+
+    rdma_submission_ring(rdma_submission_ring &&) = delete;
+    rdma_submission_ring &operator=(rdma_submission_ring &&) = delete;
+
+    ~rdma_submission_ring() = default;
+
+    size_t get_capacity() const { return mask + 1; }
+
+    //! \brief Submits a verb with its own wr_id and signaling, from any
+    //! thread. If signaled, its wr_id must come from the router, as
+    //! `progress()` only dispatches routed completions.
+    //!
+    //! \return False if the ring is full.
+    template <typename Tag, uint32_t S>
+    bool try_submit(rdma_verb<Tag, S> &verb) {
+        static_assert(
+            std::is_same_v<typename rdma_verb<Tag, S>::wr_type,
+                           ibv_exp_send_wr>,
+            "only send verbs can be submitted");
+        return try_push(verb, verb.get_id(), verb.is_notified());
+    }
+
+    //! \brief Submits a signaled verb whose completion is handed to
+    //! `continuation` on the owner thread, from any thread.
+    //!
+    //! \return False if the ring or the router is full.
+    template <typename Tag, uint32_t S, typename F>
+        requires std::invocable<F &, rdma_success_cqe const &>
+    bool try_submit(rdma_verb<Tag, S> &verb, F &&continuation) {
+        static_assert(
+            std::is_same_v<typename rdma_verb<Tag, S>::wr_type,
+                           ibv_exp_send_wr>,
+            "only send verbs can be submitted");
+        auto wr_id = router.try_add(std::forward<F>(continuation));
+        if (!wr_id.has_value()) {
+            return false;
+        }
+        if (!try_push(verb, wr_id.value(), true)) {
+            router.cancel(wr_id.value());
+            return false;
+        }
+        return true;
+    }
+
+    //! \brief Submits a verb, spinning while the ring is full.
+    template <typename Tag, uint32_t S> void submit(rdma_verb<Tag, S> &verb) {
+        while (!try_submit(verb)) {
+        }
+    }
+
+    //! \brief Submits a signaled verb, spinning while the ring or the router
+    //! is full.
+    template <typename Tag, uint32_t S, typename F>
+        requires std::invocable<F &, rdma_success_cqe const &>
+    void submit(rdma_verb<Tag, S> &verb, F &&continuation) {
+        while (!try_submit(verb, continuation)) {
+        }
+    }
+
+    //! \brief Submits a signaled verb and waits until the owner thread
+    //! reports its completion. Must not be called from the owner thread,
+    //! which would wait for itself forever.
+    template <typename Tag, uint32_t S>
+    rdma_success_cqe submit_and_wait(rdma_verb<Tag, S> &verb) {
+        std::atomic<bool> done{false};
+        rdma_success_cqe cqe = {};
+        submit(verb, [&done, &cqe](rdma_success_cqe const &c) {
+            cqe = c;
+            done.store(true, std::memory_order_release);
+        });
+        while (!done.load(std::memory_order_acquire)) {
+        }
+        return cqe;
+    }
+
+    //! \brief Posts the verbs submitted so far, `kSubmitBatch` per doorbell,
+    //! as long as the send queue has free slots. Only the owner thread may
+    //! drain.
+    //!
+    //! \return The number of verbs posted.
+    size_t drain() {
+        size_t ret = 0;
+        while (true) {
+            size_t limit = std::min<size_t>(
+                kSubmitBatch, qp.get_sq_tracker()->get_available());
+            size_t n = 0;
+            for (; n < limit; ++n) {
+                slot &s = slots[head & mask];
+                if (s.seq.load(std::memory_order_acquire) != head + 1) {
+                    break;
+                }
+                fill(n, s);
+                s.seq.store(head + mask + 1, std::memory_order_release);
+                ++head;
+            }
+            if (n == 0) {
+                return ret;
+            }
+            batch.set_size(n);
+            qp.post_verb(batch);
+            ret += n;
+        }
+    }
+
+    //! \brief Drains the ring, then polls `cq` through the router, running
+    //! the continuations of completed verbs. Only the owner thread may make
+    //! progress.
+    //!
+    //! \return The number of completions harvested.
+    int progress(rdma_cq const &cq, int num_entries = kMaxPollCq) {
+        drain();
+        return router.poll(cq, num_entries);
+    }
+
+protected:
+    template <typename Tag, uint32_t S>
+    bool try_push(rdma_verb<Tag, S> &verb, uint64_t wr_id, bool notified) {
+        auto const &wr =
+            verb.get_wr(qp.is_auto_inline(), qp.get_max_inline_data());
+        RDMALIB2_ASSERT(static_cast<uint32_t>(wr.num_sge) <= MaxSge);
+
+        // Claim a slot, as in Vyukov's bounded queue
+        uint64_t pos = tail.load(std::memory_order_relaxed);
+        slot *s = nullptr;
+        while (true) {
+            s = &slots[pos & mask];
+            uint64_t seq = s->seq.load(std::memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(seq - pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        s->wr = wr;
+        s->wr.next = nullptr;
+        s->wr.sg_list = s->sgl;
+        std::copy_n(wr.sg_list, wr.num_sge, s->sgl);
+        s->wr_id = wr_id;
+        s->notified = notified;
+        s->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! \brief Copies a drained slot into slot `i` of the batch, keeping the
+    //! batch's own list links.
+    void fill(size_t i, slot const &s) {
+        ibv_exp_send_wr &wr = batch.get_wr(i);
+        ibv_sge *sgl = wr.sg_list;
+        ibv_exp_send_wr *next = wr.next;
+        wr = s.wr;
+        wr.sg_list = sgl;
+        wr.next = next;
+        std::copy_n(s.sgl, s.wr.num_sge, sgl);
+        batch.set_id(i, s.wr_id).set_notify(i, s.notified);
+    }
+
+    rdma_qp<Type> const &qp;
+    rdma_completion_router &router;
+    size_t mask;
+    std::unique_ptr<slot[]> slots;
+
+    // Producers and the owner each get their own cache line
+    alignas(64) std::atomic<uint64_t> tail{0};
+    alignas(64) uint64_t head = 0;
+    rdma_verb_batch<kSubmitBatch, MaxSge> batch;
+};
+
+} // namespace rdmalib2
+
+#endif // __RDMALIB2_SUBMIT_H__
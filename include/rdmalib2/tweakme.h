@@ -3,6 +3,7 @@
 #ifndef __RDMALIB2_TWEAKME_H__
 #define __RDMALIB2_TWEAKME_H__
 
+#include <cstddef>
 #include <cstdint>
 
 namespace rdmalib2 {
@@ -13,7 +14,19 @@ static constexpr int kQpDepth = 256;
 static constexpr int kCqDepth = 256;
 static constexpr uint32_t kMaxSge = 16;
 static constexpr uint32_t kMaxInlineData = 64;
+static constexpr uint32_t kUdQkey = 0x11111111;
+static constexpr uint64_t kDcKey = 0x2222222222222222;
 static constexpr int kMaxPollCq = 32;
+static constexpr uint32_t kCqSpinBudget = 1 << 14;
+static constexpr size_t kRecvRingBatch = 32;
+static constexpr size_t kRouterContinuationSize = 16;
+static constexpr size_t kAhCacheSize = 1024;
+static constexpr size_t kDciPoolSize = 8;
+static constexpr size_t kSubmitRingSize = 1024;
+static constexpr size_t kSubmitBatch = 32;
+static constexpr size_t kFlowFlushBatch = 32;
+static constexpr size_t kMaxRails = 8;
+static constexpr size_t kRailStripeMin = 64 << 10;
 
 } // namespace rdmalib2
 
@@ -5,12 +5,25 @@
 
 #include "predeclare/qp_pre.h"
 #include "predeclare/verb_pre.h"
+#include "srq.h"
 
 namespace rdmalib2 {
 
-template <typename Wr>
+template <typename Wr, uint32_t MaxSge>
 template <ibv_qp_type Type>
-void rdma_verb<Wr>::execute(rdma_qp<Type> const &qp) {
+void rdma_verb<Wr, MaxSge>::execute(rdma_qp<Type> const &qp) {
+    qp.post_verb(*this);
+}
+
+template <typename Wr, uint32_t MaxSge>
+void rdma_verb<Wr, MaxSge>::execute(rdma_srq const &srq) {
+    srq.post_verb(*this);
+}
+
+template <ibv_exp_wr_opcode Opcode, uint32_t MaxSge>
+template <ibv_qp_type Type>
+void rdma_verb<wr_type_base<Opcode>, MaxSge>::execute(
+    rdma_qp<Type> const &qp) {
     qp.post_verb(*this);
 }
 
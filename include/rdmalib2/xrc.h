@@ -0,0 +1,108 @@
+#pragma once
+
+#ifndef __RDMALIB2_XRC_H__
+#define __RDMALIB2_XRC_H__
+
+#include "context.h"
+#include <fcntl.h>
+#include <new>
+#include <optional>
+#include <string>
+#include <unistd.h>
+
+namespace rdmalib2 {
+
+//! \brief An XRC domain, which groups XRC SRQs and the XRC receive QPs that
+//! feed them.
+//!
+//! Processes of a node that open the domain through the same file share it,
+//! so an XRC send QP connected to any XRC receive QP of the domain reaches
+//! the XRC SRQs of every process on that node. A process then needs one XRC
+//! send QP per remote node rather than one RC QP per remote process, and
+//! picks the receiving process by SRQ number on each send.
+class rdma_xrcd {
+public:
+    //! \brief Opens a domain private to this process.
+    explicit rdma_xrcd(rdma_context const &ctx) : rdma_xrcd(ctx, -1, "") {}
+
+    //! \brief Opens the domain shared by every process of this node that
+    //! opens `path`, creating the file if needed.
+    rdma_xrcd(rdma_context const &ctx, std::string const &path)
+        : rdma_xrcd(ctx, open_path(path), path) {}
+
+protected:
+    rdma_xrcd(rdma_context const &ctx, int fd, std::string const &path)
+        : ctx(ctx) {
+        auto xrcd = create_rdma_xrcd(ctx, fd);
+        // The domain holds on to the inode, not to the file descriptor
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        if (xrcd.has_value()) {
+            this->xrcd = xrcd.value();
+            spdlog::trace("opened XRC domain {:p} at '{}' for context {:p}",
+                          reinterpret_cast<void *>(this->xrcd), path,
+                          reinterpret_cast<void const *>(ctx.get_context()));
+        } else {
+            spdlog::error("failed to open XRC domain at '{}' for context {:p}",
+                          path,
+                          reinterpret_cast<void const *>(ctx.get_context()));
+            panic_with_errno();
+        }
+    }
+
+public:
+    rdma_xrcd(rdma_xrcd const &) = delete;
+    rdma_xrcd &operator=(rdma_xrcd const &) = delete;
+
+    rdma_xrcd(rdma_xrcd &&other) noexcept : ctx(other.ctx), xrcd(other.xrcd) {
+        other.xrcd = nullptr;
+    }
+
+    rdma_xrcd &operator=(rdma_xrcd &&other) & noexcept {
+        if (this != &other) {
+            this->~rdma_xrcd();
+            new (this) rdma_xrcd(std::move(other));
+        }
+        return *this;
+    }
+
+    ~rdma_xrcd() {
+        if (xrcd) {
+            spdlog::trace("closing XRC domain {:p}",
+                          reinterpret_cast<void *>(xrcd));
+            ibv_close_xrcd(xrcd);
+            xrcd = nullptr;
+        }
+    }
+
+    ibv_xrcd *get_xrcd() const { return xrcd; }
+
+protected:
+    static int open_path(std::string const &path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CREAT, 0600);
+        if (fd < 0) {
+            spdlog::error("failed to open XRC domain file '{}'", path);
+            panic_with_errno();
+        }
+        return fd;
+    }
+
+    static std::optional<ibv_xrcd *> create_rdma_xrcd(rdma_context const &ctx,
+                                                      int fd) {
+        ibv_xrcd_init_attr attr = {};
+        attr.comp_mask = IBV_XRCD_INIT_ATTR_FD | IBV_XRCD_INIT_ATTR_OFLAGS;
+        attr.fd = fd;
+        attr.oflags = O_CREAT;
+
+        ibv_xrcd *xrcd = ibv_open_xrcd(ctx.get_context(), &attr);
+        return xrcd ? std::make_optional(xrcd) : std::nullopt;
+    }
+
+    rdma_context const &ctx;
+    ibv_xrcd *xrcd = nullptr;
+};
+
+} // namespace rdmalib2
+
+#endif // __RDMALIB2_XRC_H__
@@ -0,0 +1,51 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <rdmalib2/rdmalib2.h>
+
+// A tracked send queue keeps the slots of trailing unsignaled work requests
+// until a later signaled one completes, so a full-depth batch posted behind
+// one of them must be split rather than wait for slots forever.
+
+static constexpr size_t MEM_SIZE = 4096;
+static constexpr size_t BATCH = 256;
+
+TEST_CASE("rdmalib2 auto signaling posts a full-depth batch", "rdmalib2") {
+    rdmalib2::rdma_context ctx{"mlx5_0"};
+    rdmalib2::rdma_cq cq{ctx, static_cast<int>(BATCH)};
+    rdmalib2::rdma_qp_config config;
+    config.depth = 64;
+    rdmalib2::rdma_rc_qp qp{ctx, cq, cq, config};
+    qp.connect(qp.get_info());
+    qp.enable_auto_signal();
+
+    uint32_t depth = qp.get_sq_tracker()->get_depth();
+    REQUIRE(depth <= BATCH);
+
+    char *buf = new char[MEM_SIZE];
+    rdmalib2::rdma_memory_region mem{ctx, buf, MEM_SIZE};
+    rdmalib2::rdma_remote_memory_slice remote{
+        reinterpret_cast<uint64_t>(mem.get_ptr()) + MEM_SIZE / 2, 8,
+        mem.get_rkey()};
+
+    // Stays in flight until a later verb is signaled
+    rdmalib2::rdma_write single{mem.slice(0, 8)};
+    single.set_remote_memory(remote);
+    qp.post_verb(single);
+
+    rdmalib2::rdma_verb_batch<BATCH> batch;
+    for (uint32_t i = 0; i < depth; ++i) {
+        batch.set_write(i, mem.slice(8 * (i % 64), 8), remote, i)
+            .set_notify(i, i + 1 == depth);
+    }
+    batch.set_size(depth);
+    qp.post_verb(batch);
+
+    auto cqes = cq.try_poll_with_wc(1);
+    while (cqes.empty()) {
+        cqes = cq.try_poll_with_wc(1);
+    }
+    REQUIRE(cqes[0].wr_id == depth - 1);
+    REQUIRE(qp.get_sq_tracker()->get_outstanding() == 0);
+
+    delete[] buf;
+}
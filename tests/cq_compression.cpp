@@ -0,0 +1,48 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <rdmalib2/rdmalib2.h>
+
+// Compares the small-write message rate of a looped-back RC QP with and
+// without CQE compression. Every write is signaled, so the completion path
+// dominates.
+
+static constexpr size_t MEM_SIZE = 4096;
+static constexpr int BATCH = 32;
+
+template <typename Features>
+static void run_write_batches(rdmalib2::rdma_context &ctx,
+                              rdmalib2::rdma_memory_region &mem,
+                              Features const &features, char const *name) {
+    rdmalib2::rdma_cq cq{ctx, rdmalib2::kCqDepth, features};
+    rdmalib2::rdma_rc_qp qp{ctx, cq, cq};
+    qp.connect(qp.get_info());
+
+    rdmalib2::rdma_verb_batch<BATCH> batch;
+    rdmalib2::rdma_remote_memory_slice remote{
+        reinterpret_cast<uint64_t>(mem.get_ptr()) + MEM_SIZE / 2, 8,
+        mem.get_rkey()};
+    for (int i = 0; i < BATCH; ++i) {
+        batch.set_write(i, mem.slice(8 * i, 8), remote, i)
+            .set_notify(i, true)
+            .set_inline(i, true);
+    }
+
+    BENCHMARK(name) {
+        batch.execute(qp);
+        cq.poll(BATCH);
+    };
+}
+
+TEST_CASE("rdmalib2 CQE compression message rate", "[!benchmark]") {
+    rdmalib2::rdma_context ctx{"mlx5_0"};
+    char *buf = new char[MEM_SIZE];
+    rdmalib2::rdma_memory_region mem{ctx, buf, MEM_SIZE};
+
+    run_write_batches(ctx, mem, rdmalib2::rdma_cq::no_features,
+                      "32 signaled 8 B writes, plain CQEs");
+    run_write_batches(ctx, mem, rdmalib2::rdma_cq::compressed_cqe,
+                      "32 signaled 8 B writes, compressed CQEs");
+
+    delete[] buf;
+}
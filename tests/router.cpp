@@ -0,0 +1,31 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <rdmalib2/rdmalib2.h>
+
+// Completions are fabricated, so these cases run without an RDMA device.
+
+TEST_CASE("rdmalib2 completion router dispatches by wr_id", "rdmalib2") {
+    rdmalib2::rdma_completion_router router(2);
+    int hits[2] = {};
+
+    uint64_t a = router.add(
+        [&hits](rdmalib2::rdma_success_cqe const &) { ++hits[0]; });
+    uint64_t b = router.add(
+        [&hits](rdmalib2::rdma_success_cqe const &) { ++hits[1]; });
+    REQUIRE(rdmalib2::rdma_completion_router::is_routed(a));
+    REQUIRE(a != b);
+    REQUIRE_FALSE(router.try_add([](auto const &) {}).has_value());
+
+    using op_type = rdmalib2::rdma_success_cqe::op_type;
+    REQUIRE(router.dispatch({op_type::RdmaRead, b, 8, 0}));
+    REQUIRE(router.dispatch({op_type::RdmaWrite, a, 8, 0}));
+    REQUIRE(hits[0] == 1);
+    REQUIRE(hits[1] == 1);
+    REQUIRE_FALSE(router.dispatch({op_type::Send, 42, 0, 0}));
+
+    // A reused slot gets a new generation
+    uint64_t c = router.add([](auto const &) {});
+    REQUIRE(c != a);
+    REQUIRE(c != b);
+    router.cancel(c);
+}
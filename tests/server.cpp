@@ -17,8 +17,9 @@ int main(int argc, char **argv) {
     std::optional<rdmalib2::rdma_rc_qp> qp_box;
 
     spdlog::info("server started");
-    cm.run_server([&](rdmalib2::rdma_rc_qp qp, rdmalib2::rdma_cq send_cq,
-                      rdmalib2::rdma_cq recv_cq) {
+    cm.run_server([&](rdmalib2::rdma_rc_qp qp,
+                      std::unique_ptr<rdmalib2::rdma_cq> send_cq,
+                      std::unique_ptr<rdmalib2::rdma_cq> recv_cq) {
         rdmalib2::rdma_recv wr{mslice};
         wr.execute(qp);
     });